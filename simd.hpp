@@ -28,8 +28,15 @@
 #ifndef _simd_hpp_
 #define _simd_hpp_
 #include <type_traits>
+#include <utility>
+#include <limits>
+#include <cstdint>
 #include <cmath>
 
+#if defined (__SSE2__)
+#include <immintrin.h>
+#endif
+
 template<class T, unsigned int N>
     class simd
     {
@@ -61,6 +68,8 @@ template<class T, unsigned int N>
         constexpr simd(const aligned &r) : r(r)   {}
         constexpr simd(const simd    &s) : r(s.r) {} 
 
+        simd & operator = (const simd &s) = default;
+
         // Costruction from single or multiple scalar values
         template<class    V> constexpr simd (const V &   x) : r(T(x) - aligned{}) {}
         template<class... V> constexpr simd (const V &...x) : r{T(x)...}          {}
@@ -70,7 +79,16 @@ template<class T, unsigned int N>
 
         // Store and load operations
         static simd load  (const T *p) { return *reinterpret_cast<const aligned   *>(p); } 
-        static simd loadu (const T *p) { return *reinterpret_cast<const unaligned *>(p); }    
+        static simd loadu (const T *p) { return aligned(*reinterpret_cast<const unaligned *>(p)); }    
+
+        void store  (T *p) const { *reinterpret_cast<aligned   *>(p) = r; }
+        void storeu (T *p) const { *reinterpret_cast<unaligned *>(p) = r; }
+
+        // Partial load and store of the first n < N elements, the other lanes are set to fill
+        static simd loadu (const T *p, unsigned int n, T fill = T(0))
+            { T b[N]; for (unsigned int i = 0; i < N; i++) b[i] = i < n ? p[i] : fill; return loadu(b); }
+
+        void storeu (T *p, unsigned int n) const { for (unsigned int i = 0; i < n; i++) p[i] = r[i]; }
 
         // Assignment operators
         template<class V> simd & operator  =  (const V &x) { r  =  simd(x).r; return *this; }
@@ -154,6 +172,24 @@ template<class T, unsigned int N>
 template<class T>
     constexpr bool is_simd_or_scalar = std::is_arithmetic<T>::value || is_simd<T>;
 
+// Type of twice the size of T with the same signedness, float becomes double
+template<class T>
+    using wider_t = std::conditional_t<std::is_floating_point<T>::value, double,
+        std::conditional_t<std::is_signed<T>::value,
+            std::conditional_t<sizeof(T) == 1, int16_t,  std::conditional_t<sizeof(T) == 2, int32_t,  int64_t>>,
+            std::conditional_t<sizeof(T) == 1, uint16_t, std::conditional_t<sizeof(T) == 2, uint32_t, uint64_t>>>>;
+
+// Number of lanes of T in the widest registers enabled
+template<class T>
+    constexpr unsigned int simd_native_size =
+#if defined (__AVX512F__)
+        64 / sizeof(T);
+#elif defined (__AVX__)
+        32 / sizeof(T);
+#else
+        16 / sizeof(T);
+#endif
+
 // Binary operators
 template<class T, class V, class E = std::enable_if_t<is_simd_or_scalar<T> && is_simd_or_scalar<V>>, class R = std::common_type_t<T,V>> constexpr R operator +  (const T &x, const V &y) { return R(x).r +  R(y).r; }  
 template<class T, class V, class E = std::enable_if_t<is_simd_or_scalar<T> && is_simd_or_scalar<V>>, class R = std::common_type_t<T,V>> constexpr R operator -  (const T &x, const V &y) { return R(x).r -  R(y).r; }  
@@ -224,6 +260,234 @@ template<class T, class V, class W, class E = std::enable_if_t<is_simd<T>>, clas
     constexpr R blend (const T &test, const V &yes, const W &no)
         { return test.r ? R(yes).r : R(no).r; }
 
+// Reinterpretation of the bits of an object as elements of type U
+template<class U, class T, unsigned int N, class R = simd<U, N * sizeof(T) / sizeof(U)>>
+    constexpr R reinterpret (const simd<T,N> &s) { return (typename R::aligned) s.r; }
+
+// Shuffles with indexes known at compile time. Index i < N selects a[i], index i >= N
+// selects b[i - N] and index -1 leaves the lane undefined. Constant indexes let the
+// compiler emit immediate form instructions (vshufps, vpermilps, vpalignr...) instead
+// of the variable permutes generated by the shuffle operators of the class.
+#if defined (__has_builtin)
+#if __has_builtin(__builtin_shufflevector)
+#define _simd_shufflevector_
+#endif
+#endif
+
+#ifdef _simd_shufflevector_
+template<int... I, class T, unsigned int N>
+    constexpr simd<T, sizeof...(I)> shuffle (const simd<T,N> &a, const simd<T,N> &b)
+        { return __builtin_shufflevector(a.r, b.r, I...); }
+#else
+template<int... I, class T, unsigned int N>
+    constexpr simd<T, sizeof...(I)> shuffle (const simd<T,N> &a, const simd<T,N> &b)
+        { return simd<T, sizeof...(I)>((I < 0 ? T() : I < int(N) ? a[I] : b[I - N])...); }
+#endif
+
+template<int... I, class T, unsigned int N>
+    constexpr simd<T, sizeof...(I)> permute (const simd<T,N> &s)
+        { return shuffle<I...>(s, s); }
+
+// Lane movements. Overloads taking an std::integer_sequence expand the constant indexes 
+// of the shuffle, lanes are numbered as in memory so "left" moves them towards lane 0.
+
+// Rotation as std::rotate, the lane K becomes the first one
+template<int K, class T, unsigned int N, int... I>
+    constexpr simd<T,N> rotate_lanes (const simd<T,N> &s, std::integer_sequence<int, I...>)
+        { return permute<((I + K) % int(N) + int(N)) % int(N)...>(s); }
+
+template<int K, class T, unsigned int N>
+    constexpr simd<T,N> rotate_lanes (const simd<T,N> &s)
+        { return rotate_lanes<K>(s, std::make_integer_sequence<int, N>()); }
+
+// Shifts as std::shift_left and std::shift_right, vacated lanes are filled with zeros
+template<int K, class T, unsigned int N, int... I>
+    constexpr simd<T,N> shift_lanes_left (const simd<T,N> &s, std::integer_sequence<int, I...>)
+        { return shuffle<(I + K)...>(s, simd<T,N>(0)); }
+
+template<int K, class T, unsigned int N>
+    constexpr simd<T,N> shift_lanes_left (const simd<T,N> &s)
+        { static_assert(K >= 0 && K <= int(N), "invalid shift"); return shift_lanes_left<K>(s, std::make_integer_sequence<int, N>()); }
+
+template<int K, class T, unsigned int N, int... I>
+    constexpr simd<T,N> shift_lanes_right (const simd<T,N> &s, std::integer_sequence<int, I...>)
+        { return shuffle<(I < K ? int(N) : I - K)...>(s, simd<T,N>(0)); }
+
+template<int K, class T, unsigned int N>
+    constexpr simd<T,N> shift_lanes_right (const simd<T,N> &s)
+        { static_assert(K >= 0 && K <= int(N), "invalid shift"); return shift_lanes_right<K>(s, std::make_integer_sequence<int, N>()); }
+
+// Lanes in reverse order
+template<class T, unsigned int N, int... I>
+    constexpr simd<T,N> reverse (const simd<T,N> &s, std::integer_sequence<int, I...>)
+        { return permute<(int(N) - 1 - I)...>(s); }
+
+template<class T, unsigned int N>
+    constexpr simd<T,N> reverse (const simd<T,N> &s)
+        { return reverse(s, std::make_integer_sequence<int, N>()); }
+
+// All lanes set to the value of lane L
+template<int L, class T, unsigned int N, int... I>
+    constexpr simd<T,N> broadcast_lane (const simd<T,N> &s, std::integer_sequence<int, I...>)
+        { return permute<(L + 0 * I)...>(s); }
+
+template<int L, class T, unsigned int N>
+    constexpr simd<T,N> broadcast_lane (const simd<T,N> &s)
+        { static_assert(L >= 0 && L < int(N), "invalid lane"); return broadcast_lane<L>(s, std::make_integer_sequence<int, N>()); }
+
+// Join two objects into a twice larger one and split them back
+template<class T, unsigned int N, int... I>
+    constexpr simd<T,2*N> concat (const simd<T,N> &a, const simd<T,N> &b, std::integer_sequence<int, I...>)
+        { return shuffle<I...>(a, b); }
+
+template<class T, unsigned int N>
+    constexpr simd<T,2*N> concat (const simd<T,N> &a, const simd<T,N> &b)
+        { return concat(a, b, std::make_integer_sequence<int, 2*N>()); }
+
+template<class T, unsigned int N, int... I>
+    constexpr simd<T,N/2> lo_half (const simd<T,N> &s, std::integer_sequence<int, I...>)
+        { return permute<I...>(s); }
+
+template<class T, unsigned int N>
+    constexpr simd<T,N/2> lo_half (const simd<T,N> &s)
+        { static_assert(N % 2 == 0, "odd size"); return lo_half(s, std::make_integer_sequence<int, N/2>()); }
+
+template<class T, unsigned int N, int... I>
+    constexpr simd<T,N/2> hi_half (const simd<T,N> &s, std::integer_sequence<int, I...>)
+        { return permute<(I + int(N/2))...>(s); }
+
+template<class T, unsigned int N>
+    constexpr simd<T,N/2> hi_half (const simd<T,N> &s)
+        { static_assert(N % 2 == 0, "odd size"); return hi_half(s, std::make_integer_sequence<int, N/2>()); }
+
+template<class T, unsigned int N>
+    constexpr std::pair<simd<T,N/2>, simd<T,N/2> > split (const simd<T,N> &s)
+        { return { lo_half(s), hi_half(s) }; }
+
+// Interleave of the lower or upper halves of a and b: (a0,b0,a1,b1,...)
+template<class T, unsigned int N, int... I>
+    constexpr simd<T,N> zip_lo (const simd<T,N> &a, const simd<T,N> &b, std::integer_sequence<int, I...>)
+        { return shuffle<(I / 2 + (I % 2) * int(N))...>(a, b); }
+
+template<class T, unsigned int N>
+    constexpr simd<T,N> zip_lo (const simd<T,N> &a, const simd<T,N> &b)
+        { return zip_lo(a, b, std::make_integer_sequence<int, N>()); }
+
+template<class T, unsigned int N, int... I>
+    constexpr simd<T,N> zip_hi (const simd<T,N> &a, const simd<T,N> &b, std::integer_sequence<int, I...>)
+        { return shuffle<(I / 2 + int(N / 2) + (I % 2) * int(N))...>(a, b); }
+
+template<class T, unsigned int N>
+    constexpr simd<T,N> zip_hi (const simd<T,N> &a, const simd<T,N> &b)
+        { return zip_hi(a, b, std::make_integer_sequence<int, N>()); }
+
+// Even or odd elements of a followed by the ones of b, inverse of zip_lo and zip_hi
+template<class T, unsigned int N, int... I>
+    constexpr simd<T,N> unzip_even (const simd<T,N> &a, const simd<T,N> &b, std::integer_sequence<int, I...>)
+        { return shuffle<(2 * I)...>(a, b); }
+
+template<class T, unsigned int N>
+    constexpr simd<T,N> unzip_even (const simd<T,N> &a, const simd<T,N> &b)
+        { return unzip_even(a, b, std::make_integer_sequence<int, N>()); }
+
+template<class T, unsigned int N, int... I>
+    constexpr simd<T,N> unzip_odd (const simd<T,N> &a, const simd<T,N> &b, std::integer_sequence<int, I...>)
+        { return shuffle<(2 * I + 1)...>(a, b); }
+
+template<class T, unsigned int N>
+    constexpr simd<T,N> unzip_odd (const simd<T,N> &a, const simd<T,N> &b)
+        { return unzip_odd(a, b, std::make_integer_sequence<int, N>()); }
+
+// Matrix transposition of N rows of N elements. The square blocks contained in a 128-bit 
+// lane are transposed with unpack instructions, then the whole blocks are exchanged.
+template<class T, unsigned int N, int... I>
+    inline void transpose_unpack (simd<T,N> (&rows)[N], std::integer_sequence<int, I...>)
+    {
+        // Number of elements in a 128-bit lane
+        constexpr int L = N * sizeof(T) > 16 ? 16 / sizeof(T) : N;
+
+        for (int s = 1; s < L; s *= 2)
+            for (int g = 0; g < int(N); g += L)
+            {
+                simd<T,N> t[L];
+
+                for (int i = 0; i < L / 2; i++)
+                {
+                    t[2*i]   = shuffle<((I / L) * L + (I % L) / 2         + (I % 2) * int(N))...>(rows[g+i], rows[g+i+L/2]);
+                    t[2*i+1] = shuffle<((I / L) * L + (I % L) / 2 + L / 2 + (I % 2) * int(N))...>(rows[g+i], rows[g+i+L/2]);
+                }
+
+                for (int i = 0; i < L; i++)
+                    rows[g+i] = t[i];
+            }
+    }
+
+template<unsigned int K, class T, unsigned int N, int... I>
+    inline void transpose_blocks (simd<T,N> (&rows)[N], std::integer_sequence<int, I...> s, std::integral_constant<unsigned int, K>)
+    {
+        for (unsigned int i = 0; i < N; i++)
+            if (!(i & K))
+            {
+                simd<T,N> a = rows[i], b = rows[i+K];
+
+                rows[i]   = shuffle<((I & int(K)) ? I - int(K) + int(N) : I)...>(a, b);
+                rows[i+K] = shuffle<((I & int(K)) ? I + int(N) : I + int(K))...>(a, b);
+            }
+
+        transpose_blocks(rows, s, std::integral_constant<unsigned int, 2*K>());
+    }
+
+template<class T, unsigned int N, int... I>
+    inline void transpose_blocks (simd<T,N> (&)[N], std::integer_sequence<int, I...>, std::integral_constant<unsigned int, N>) {}
+
+template<class T, unsigned int N>
+    inline void transpose (simd<T,N> (&rows)[N])
+    {
+        static_assert((N & (N - 1)) == 0, "size is not a power of two");
+
+        constexpr unsigned int L = N * sizeof(T) > 16 ? 16 / sizeof(T) : N;
+
+        transpose_unpack(rows, std::make_integer_sequence<int, N>());
+        transpose_blocks(rows, std::make_integer_sequence<int, N>(), std::integral_constant<unsigned int, L>());
+    }
+
+// Table lookup of 16 bytes as pshufb: each element of idx is replaced by table[idx & 15] 
+// or by zero when its high bit is set. Larger objects use the same table for every 16 bytes.
+template<unsigned int N, int... I>
+    inline simd<uint8_t,N> lookup16 (const simd<uint8_t,16> &table, const simd<uint8_t,N> &idx, std::integer_sequence<int, I...>)
+    {
+        static_assert(N % 16 == 0, "size is not a multiple of 16");
+
+        simd<uint8_t,N> high = simd<int8_t,N>(idx) >> 7;
+
+        return permute<(I % 16)...>(table)[idx & uint8_t(15)] & ~high;
+    }
+
+template<unsigned int N>
+    inline simd<uint8_t,N> lookup16 (const simd<uint8_t,16> &table, const simd<uint8_t,N> &idx)
+        { return lookup16(table, idx, std::make_integer_sequence<int, N>()); }
+
+#if defined (__SSSE3__)
+inline simd<uint8_t,16> lookup16 (const simd<uint8_t,16> &table, const simd<uint8_t,16> &idx)
+    { return (simd<uint8_t,16>::aligned) _mm_shuffle_epi8((__m128i) table.r, (__m128i) idx.r); }
+#endif
+
+#if defined (__AVX2__)
+inline simd<uint8_t,32> lookup16 (const simd<uint8_t,16> &table, const simd<uint8_t,32> &idx)
+    { return (simd<uint8_t,32>::aligned) _mm256_shuffle_epi8(_mm256_broadcastsi128_si256((__m128i) table.r), (__m256i) idx.r); }
+#endif
+
+#if defined (__AVX512BW__)
+inline simd<uint8_t,64> lookup16 (const simd<uint8_t,16> &table, const simd<uint8_t,64> &idx)
+    { return (simd<uint8_t,64>::aligned) _mm512_shuffle_epi8((__m512i) concat(concat(table, table), concat(table, table)).r, (__m512i) idx.r); }
+#endif
+
+// Classification of bytes using two tables indexed by their low and high nibbles, a byte
+// belongs to the classes whose bits are set in both entries.
+template<unsigned int N>
+    inline simd<uint8_t,N> classify (const simd<uint8_t,N> &s, const simd<uint8_t,16> &lo, const simd<uint8_t,16> &hi)
+        { return lookup16(lo, s & uint8_t(15)) & lookup16(hi, s >> uint8_t(4)); }
+
 template<class T, unsigned int N> inline bool any (const simd<T,N> &s) { bool r = s[0]; for(unsigned int i = 1; i < N; i++) r = r || s[i]; return r; }
 template<class T, unsigned int N> inline bool all (const simd<T,N> &s) { bool r = s[0]; for(unsigned int i = 1; i < N; i++) r = r && s[i]; return r; }
 template<class T, unsigned int N> inline T    sum (const simd<T,N> &s) { T    r = s[0]; for(unsigned int i = 1; i < N; i++) r = r +  s[i]; return r; }
@@ -277,4 +541,1073 @@ namespace std
     template<class T, unsigned int N> inline simd<T,N> min    (const simd<T,N> &a, const simd<T,N> &b) { return a.r < b.r ? a.r : b.r; }
 }
 
-#endif
\ No newline at end of file
+// Saturating addition and subtraction, results out of range are clamped to the limits of T
+template<class T, unsigned int N>
+    inline simd<T,N> adds (const simd<T,N> &a, const simd<T,N> &b, std::false_type)
+        { simd<T,N> r = a + b; return r | simd<T,N>(r < a); }
+
+template<class T, unsigned int N>
+    inline simd<T,N> adds (const simd<T,N> &a, const simd<T,N> &b, std::true_type)
+    {
+        typedef simd<std::make_unsigned_t<T>,N> U;
+
+        simd<T,N> r = U(a) + U(b);
+        simd<T,N> s = (a >> T(8 * sizeof(T) - 1)) ^ std::numeric_limits<T>::max();
+
+        return blend(((a ^ r) & (b ^ r)) < T(0), s, r);
+    }
+
+template<class T, unsigned int N>
+    inline simd<T,N> subs (const simd<T,N> &a, const simd<T,N> &b, std::false_type)
+        { simd<T,N> r = a - b; return r & simd<T,N>(r <= a); }
+
+template<class T, unsigned int N>
+    inline simd<T,N> subs (const simd<T,N> &a, const simd<T,N> &b, std::true_type)
+    {
+        typedef simd<std::make_unsigned_t<T>,N> U;
+
+        simd<T,N> r = U(a) - U(b);
+        simd<T,N> s = (a >> T(8 * sizeof(T) - 1)) ^ std::numeric_limits<T>::max();
+
+        return blend(((a ^ b) & (a ^ r)) < T(0), s, r);
+    }
+
+template<class T, unsigned int N> inline simd<T,N> adds (const simd<T,N> &a, const simd<T,N> &b) { return adds(a, b, std::is_signed<T>()); }
+template<class T, unsigned int N> inline simd<T,N> subs (const simd<T,N> &a, const simd<T,N> &b) { return subs(a, b, std::is_signed<T>()); }
+
+// Average rounded up (a + b + 1) >> 1 computed without overflow
+template<class T, unsigned int N> inline simd<T,N> avg (const simd<T,N> &a, const simd<T,N> &b) { return (a | b) - ((a ^ b) >> T(1)); }
+
+// Absolute difference, unsigned to hold the full range of signed types
+template<class T, unsigned int N, class U = simd<std::make_unsigned_t<T>,N>> 
+    inline U absdiff (const simd<T,N> &a, const simd<T,N> &b) { return U(std::max(a, b)) - U(std::min(a, b)); }
+
+// Upper half of the double width product
+template<class T, unsigned int N, class W = simd<wider_t<T>,N>>
+    inline simd<T,N> mulhi (const simd<T,N> &a, const simd<T,N> &b) 
+    {
+        static_assert(std::is_integral<T>::value && sizeof(T) < 8, "no wider type for the product");
+        return (W(a) * W(b)) >> typename W::type(8 * sizeof(T));
+    }
+
+// Native instructions for 8 and 16 bit lanes (vpaddsb, vpsubusw, vpavgb, vpmulhw...)
+#if defined (__SSE2__)
+inline simd<int8_t,16>   adds   (const simd<int8_t,16>   &a, const simd<int8_t,16>   &b) { return (simd<int8_t,16>::aligned) _mm_adds_epi8  ((__m128i) a.r, (__m128i) b.r); }
+inline simd<uint8_t,16>  adds   (const simd<uint8_t,16>  &a, const simd<uint8_t,16>  &b) { return (simd<uint8_t,16>::aligned) _mm_adds_epu8  ((__m128i) a.r, (__m128i) b.r); }
+inline simd<int16_t,8>   adds   (const simd<int16_t,8>   &a, const simd<int16_t,8>   &b) { return (simd<int16_t,8>::aligned) _mm_adds_epi16 ((__m128i) a.r, (__m128i) b.r); }
+inline simd<uint16_t,8>  adds   (const simd<uint16_t,8>  &a, const simd<uint16_t,8>  &b) { return (simd<uint16_t,8>::aligned) _mm_adds_epu16 ((__m128i) a.r, (__m128i) b.r); }
+inline simd<int8_t,16>   subs   (const simd<int8_t,16>   &a, const simd<int8_t,16>   &b) { return (simd<int8_t,16>::aligned) _mm_subs_epi8  ((__m128i) a.r, (__m128i) b.r); }
+inline simd<uint8_t,16>  subs   (const simd<uint8_t,16>  &a, const simd<uint8_t,16>  &b) { return (simd<uint8_t,16>::aligned) _mm_subs_epu8  ((__m128i) a.r, (__m128i) b.r); }
+inline simd<int16_t,8>   subs   (const simd<int16_t,8>   &a, const simd<int16_t,8>   &b) { return (simd<int16_t,8>::aligned) _mm_subs_epi16 ((__m128i) a.r, (__m128i) b.r); }
+inline simd<uint16_t,8>  subs   (const simd<uint16_t,8>  &a, const simd<uint16_t,8>  &b) { return (simd<uint16_t,8>::aligned) _mm_subs_epu16 ((__m128i) a.r, (__m128i) b.r); }
+inline simd<uint8_t,16>  avg    (const simd<uint8_t,16>  &a, const simd<uint8_t,16>  &b) { return (simd<uint8_t,16>::aligned) _mm_avg_epu8   ((__m128i) a.r, (__m128i) b.r); }
+inline simd<uint16_t,8>  avg    (const simd<uint16_t,8>  &a, const simd<uint16_t,8>  &b) { return (simd<uint16_t,8>::aligned) _mm_avg_epu16  ((__m128i) a.r, (__m128i) b.r); }
+inline simd<int16_t,8>   mulhi  (const simd<int16_t,8>   &a, const simd<int16_t,8>   &b) { return (simd<int16_t,8>::aligned) _mm_mulhi_epi16((__m128i) a.r, (__m128i) b.r); }
+inline simd<uint16_t,8>  mulhi  (const simd<uint16_t,8>  &a, const simd<uint16_t,8>  &b) { return (simd<uint16_t,8>::aligned) _mm_mulhi_epu16((__m128i) a.r, (__m128i) b.r); }
+#endif
+
+#if defined (__AVX2__)
+inline simd<int8_t,32>   adds   (const simd<int8_t,32>   &a, const simd<int8_t,32>   &b) { return (simd<int8_t,32>::aligned) _mm256_adds_epi8  ((__m256i) a.r, (__m256i) b.r); }
+inline simd<uint8_t,32>  adds   (const simd<uint8_t,32>  &a, const simd<uint8_t,32>  &b) { return (simd<uint8_t,32>::aligned) _mm256_adds_epu8  ((__m256i) a.r, (__m256i) b.r); }
+inline simd<int16_t,16>  adds   (const simd<int16_t,16>  &a, const simd<int16_t,16>  &b) { return (simd<int16_t,16>::aligned) _mm256_adds_epi16 ((__m256i) a.r, (__m256i) b.r); }
+inline simd<uint16_t,16> adds   (const simd<uint16_t,16> &a, const simd<uint16_t,16> &b) { return (simd<uint16_t,16>::aligned) _mm256_adds_epu16 ((__m256i) a.r, (__m256i) b.r); }
+inline simd<int8_t,32>   subs   (const simd<int8_t,32>   &a, const simd<int8_t,32>   &b) { return (simd<int8_t,32>::aligned) _mm256_subs_epi8  ((__m256i) a.r, (__m256i) b.r); }
+inline simd<uint8_t,32>  subs   (const simd<uint8_t,32>  &a, const simd<uint8_t,32>  &b) { return (simd<uint8_t,32>::aligned) _mm256_subs_epu8  ((__m256i) a.r, (__m256i) b.r); }
+inline simd<int16_t,16>  subs   (const simd<int16_t,16>  &a, const simd<int16_t,16>  &b) { return (simd<int16_t,16>::aligned) _mm256_subs_epi16 ((__m256i) a.r, (__m256i) b.r); }
+inline simd<uint16_t,16> subs   (const simd<uint16_t,16> &a, const simd<uint16_t,16> &b) { return (simd<uint16_t,16>::aligned) _mm256_subs_epu16 ((__m256i) a.r, (__m256i) b.r); }
+inline simd<uint8_t,32>  avg    (const simd<uint8_t,32>  &a, const simd<uint8_t,32>  &b) { return (simd<uint8_t,32>::aligned) _mm256_avg_epu8   ((__m256i) a.r, (__m256i) b.r); }
+inline simd<uint16_t,16> avg    (const simd<uint16_t,16> &a, const simd<uint16_t,16> &b) { return (simd<uint16_t,16>::aligned) _mm256_avg_epu16  ((__m256i) a.r, (__m256i) b.r); }
+inline simd<int16_t,16>  mulhi  (const simd<int16_t,16>  &a, const simd<int16_t,16>  &b) { return (simd<int16_t,16>::aligned) _mm256_mulhi_epi16((__m256i) a.r, (__m256i) b.r); }
+inline simd<uint16_t,16> mulhi  (const simd<uint16_t,16> &a, const simd<uint16_t,16> &b) { return (simd<uint16_t,16>::aligned) _mm256_mulhi_epu16((__m256i) a.r, (__m256i) b.r); }
+#endif
+
+#if defined (__AVX512BW__)
+inline simd<int8_t,64>   adds   (const simd<int8_t,64>   &a, const simd<int8_t,64>   &b) { return (simd<int8_t,64>::aligned) _mm512_adds_epi8  ((__m512i) a.r, (__m512i) b.r); }
+inline simd<uint8_t,64>  adds   (const simd<uint8_t,64>  &a, const simd<uint8_t,64>  &b) { return (simd<uint8_t,64>::aligned) _mm512_adds_epu8  ((__m512i) a.r, (__m512i) b.r); }
+inline simd<int16_t,32>  adds   (const simd<int16_t,32>  &a, const simd<int16_t,32>  &b) { return (simd<int16_t,32>::aligned) _mm512_adds_epi16 ((__m512i) a.r, (__m512i) b.r); }
+inline simd<uint16_t,32> adds   (const simd<uint16_t,32> &a, const simd<uint16_t,32> &b) { return (simd<uint16_t,32>::aligned) _mm512_adds_epu16 ((__m512i) a.r, (__m512i) b.r); }
+inline simd<int8_t,64>   subs   (const simd<int8_t,64>   &a, const simd<int8_t,64>   &b) { return (simd<int8_t,64>::aligned) _mm512_subs_epi8  ((__m512i) a.r, (__m512i) b.r); }
+inline simd<uint8_t,64>  subs   (const simd<uint8_t,64>  &a, const simd<uint8_t,64>  &b) { return (simd<uint8_t,64>::aligned) _mm512_subs_epu8  ((__m512i) a.r, (__m512i) b.r); }
+inline simd<int16_t,32>  subs   (const simd<int16_t,32>  &a, const simd<int16_t,32>  &b) { return (simd<int16_t,32>::aligned) _mm512_subs_epi16 ((__m512i) a.r, (__m512i) b.r); }
+inline simd<uint16_t,32> subs   (const simd<uint16_t,32> &a, const simd<uint16_t,32> &b) { return (simd<uint16_t,32>::aligned) _mm512_subs_epu16 ((__m512i) a.r, (__m512i) b.r); }
+inline simd<uint8_t,64>  avg    (const simd<uint8_t,64>  &a, const simd<uint8_t,64>  &b) { return (simd<uint8_t,64>::aligned) _mm512_avg_epu8   ((__m512i) a.r, (__m512i) b.r); }
+inline simd<uint16_t,32> avg    (const simd<uint16_t,32> &a, const simd<uint16_t,32> &b) { return (simd<uint16_t,32>::aligned) _mm512_avg_epu16  ((__m512i) a.r, (__m512i) b.r); }
+inline simd<int16_t,32>  mulhi  (const simd<int16_t,32>  &a, const simd<int16_t,32>  &b) { return (simd<int16_t,32>::aligned) _mm512_mulhi_epi16((__m512i) a.r, (__m512i) b.r); }
+inline simd<uint16_t,32> mulhi  (const simd<uint16_t,32> &a, const simd<uint16_t,32> &b) { return (simd<uint16_t,32>::aligned) _mm512_mulhi_epu16((__m512i) a.r, (__m512i) b.r); }
+#endif
+
+// Full products of the even lanes in lanes twice larger, as vpmuludq and vpmuldq
+template<class T, unsigned int N, class W = simd<wider_t<T>,N/2>>
+    inline W mul_even (const simd<T,N> &a, const simd<T,N> &b) { return W(lo_half(unzip_even(a, a))) * W(lo_half(unzip_even(b, b))); }
+
+#if defined (__SSE2__)
+inline simd<uint64_t,2> mul_even (const simd<uint32_t,4>  &a, const simd<uint32_t,4>  &b) { return (simd<uint64_t,2>::aligned) _mm_mul_epu32   ((__m128i) a.r, (__m128i) b.r); }
+#endif
+#if defined (__SSE4_1__)
+inline simd<int64_t,2>  mul_even (const simd<int32_t,4>   &a, const simd<int32_t,4>   &b) { return (simd<int64_t,2>::aligned)  _mm_mul_epi32   ((__m128i) a.r, (__m128i) b.r); }
+#endif
+#if defined (__AVX2__)
+inline simd<uint64_t,4> mul_even (const simd<uint32_t,8>  &a, const simd<uint32_t,8>  &b) { return (simd<uint64_t,4>::aligned) _mm256_mul_epu32((__m256i) a.r, (__m256i) b.r); }
+inline simd<int64_t,4>  mul_even (const simd<int32_t,8>   &a, const simd<int32_t,8>   &b) { return (simd<int64_t,4>::aligned)  _mm256_mul_epi32((__m256i) a.r, (__m256i) b.r); }
+#endif
+#if defined (__AVX512F__)
+inline simd<uint64_t,8> mul_even (const simd<uint32_t,16> &a, const simd<uint32_t,16> &b) { return (simd<uint64_t,8>::aligned) _mm512_maskz_mul_epu32(-1, (__m512i) a.r, (__m512i) b.r); }
+inline simd<int64_t,8>  mul_even (const simd<int32_t,16>  &a, const simd<int32_t,16>  &b) { return (simd<int64_t,8>::aligned)  _mm512_maskz_mul_epi32(-1, (__m512i) a.r, (__m512i) b.r); }
+#endif
+
+// Upper half of 32-bit products from the products of even and odd lanes, x86 has no vpmulhd
+#if defined (__SSE2__)
+template<class T, unsigned int N, int... I>
+    inline simd<T,N> mulhi32 (const simd<T,N> &a, const simd<T,N> &b, std::integer_sequence<int, I...>)
+    {
+        simd<T,N> e = reinterpret<T>(mul_even(a, b));
+        simd<T,N> o = reinterpret<T>(mul_even(permute<(I | 1)...>(a), permute<(I | 1)...>(b)));
+
+        return shuffle<((I % 2) ? I + int(N) : I + 1)...>(e, o);
+    }
+
+template<unsigned int N> inline simd<uint32_t,N> mulhi (const simd<uint32_t,N> &a, const simd<uint32_t,N> &b) { return mulhi32(a, b, std::make_integer_sequence<int, N>()); }
+template<unsigned int N> inline simd<int32_t,N>  mulhi (const simd<int32_t,N>  &a, const simd<int32_t,N>  &b) { return mulhi32(a, b, std::make_integer_sequence<int, N>()); }
+#endif
+
+// Conversion to U clamping the values out of its range, NaN become zero
+template<class U, class T, unsigned int N>
+    inline simd<U,N> convert_saturate (const simd<T,N> &s, std::false_type, std::false_type)
+    {
+        typedef std::numeric_limits<T> LT;
+        typedef std::numeric_limits<U> LU;
+
+        constexpr T lo = std::is_signed<T>::value && std::is_signed<U>::value && sizeof(U) < sizeof(T) ? T(LU::min()) : LT::min() * std::is_signed<U>::value;
+        constexpr T hi = uintmax_t(LU::max()) < uintmax_t(LT::max()) ? T(LU::max()) : LT::max();
+
+        return std::min(std::max(s, simd<T,N>(lo)), simd<T,N>(hi));
+    }
+
+template<class U, class T, unsigned int N>
+    inline simd<U,N> convert_saturate (const simd<T,N> &s, std::true_type, std::false_type)
+    {
+        typedef std::numeric_limits<U> LU;
+
+        typedef std::make_unsigned_t<typename simd<T,N>::int_type::type> B;
+
+        // Smallest value too large for U, a power of two exactly representable by T
+        constexpr T hi = T(LU::max() / 2 + 1) * 2;
+
+        // NaN found from the bits, s != s is folded to false by -ffinite-math-only
+        constexpr B abs = B(~B(0)) >> 1;
+        constexpr B inf = abs ^ ((B(1) << (std::numeric_limits<T>::digits - 1)) - 1);
+
+        // The comparison with hi may be true for NaN too when it is rewritten as !(s < hi)
+        typename simd<T,N>::int_type nan  = (reinterpret<B>(s) & abs) > inf;
+        typename simd<T,N>::int_type over = (s >= hi) & ~nan;
+
+        simd<T,N> c = blend(over || nan, T(0), std::max(s, simd<T,N>(LU::lowest())));
+
+        // c is zero where the values are too large, the mask is converted to the width of U
+        // (as float to int64_t) to set them to the largest value
+        return simd<U,N>(c) | (reinterpret<U>(typename simd<U,N>::int_type(over)) & simd<U,N>(LU::max()));
+    }
+
+template<class U, class T, unsigned int N, class F>
+    inline simd<U,N> convert_saturate (const simd<T,N> &s, F, std::true_type) { return s; }
+
+template<class U, class T, unsigned int N>
+    inline simd<U,N> convert_saturate (const simd<T,N> &s) 
+        { return convert_saturate<U>(s, std::is_floating_point<T>(), std::is_floating_point<U>()); }
+
+// Conversion to a type twice larger, native instructions avoid the split in two halves 
+// that GCC does for __builtin_convertvector
+template<class T, unsigned int N> inline simd<wider_t<T>,N> widen (const simd<T,N> &s) { return s; }
+
+#if defined (__AVX2__)
+inline simd<int16_t,16>  widen (const simd<int8_t,16>  &s) { return (simd<int16_t,16>::aligned) _mm256_cvtepi8_epi16 ((__m128i) s.r); }
+inline simd<uint16_t,16> widen (const simd<uint8_t,16> &s) { return (simd<uint16_t,16>::aligned) _mm256_cvtepu8_epi16 ((__m128i) s.r); }
+inline simd<int32_t,8>   widen (const simd<int16_t,8>  &s) { return (simd<int32_t,8>::aligned) _mm256_cvtepi16_epi32((__m128i) s.r); }
+inline simd<uint32_t,8>  widen (const simd<uint16_t,8> &s) { return (simd<uint32_t,8>::aligned) _mm256_cvtepu16_epi32((__m128i) s.r); }
+inline simd<int64_t,4>   widen (const simd<int32_t,4>  &s) { return (simd<int64_t,4>::aligned) _mm256_cvtepi32_epi64((__m128i) s.r); }
+inline simd<uint64_t,4>  widen (const simd<uint32_t,4> &s) { return (simd<uint64_t,4>::aligned) _mm256_cvtepu32_epi64((__m128i) s.r); }
+inline simd<double,4>    widen (const simd<float,4>    &s) { return (simd<double,4>::aligned) _mm256_cvtps_pd      ((__m128) s.r); }
+#endif
+
+#if defined (__AVX512F__)
+#if defined (__AVX512BW__)
+inline simd<int16_t,32>  widen (const simd<int8_t,32>  &s) { return (simd<int16_t,32>::aligned) _mm512_maskz_cvtepi8_epi16(-1, (__m256i) s.r); }
+inline simd<uint16_t,32> widen (const simd<uint8_t,32> &s) { return (simd<uint16_t,32>::aligned) _mm512_maskz_cvtepu8_epi16(-1, (__m256i) s.r); }
+#endif
+inline simd<int32_t,16>  widen (const simd<int16_t,16> &s) { return (simd<int32_t,16>::aligned) _mm512_maskz_cvtepi16_epi32(-1, (__m256i) s.r); }
+inline simd<uint32_t,16> widen (const simd<uint16_t,16> &s) { return (simd<uint32_t,16>::aligned) _mm512_maskz_cvtepu16_epi32(-1, (__m256i) s.r); }
+inline simd<int64_t,8>   widen (const simd<int32_t,8>  &s) { return (simd<int64_t,8>::aligned) _mm512_maskz_cvtepi32_epi64(-1, (__m256i) s.r); }
+inline simd<uint64_t,8>  widen (const simd<uint32_t,8> &s) { return (simd<uint64_t,8>::aligned) _mm512_maskz_cvtepu32_epi64(-1, (__m256i) s.r); }
+inline simd<double,8>    widen (const simd<float,8>    &s) { return (simd<double,8>::aligned) _mm512_maskz_cvtps_pd(-1, (__m256) s.r); }
+#endif
+
+// Lower or upper half of the elements converted to a type twice larger
+template<class T, unsigned int N> inline simd<wider_t<T>,N/2> widen_lo (const simd<T,N> &s) { return widen(lo_half(s)); }
+template<class T, unsigned int N> inline simd<wider_t<T>,N/2> widen_hi (const simd<T,N> &s) { return widen(hi_half(s)); }
+
+// Saturating conversion of two objects packed into one of U as vpacksswb and vpackuswb
+template<class U, class T, unsigned int N>
+    inline simd<U,2*N> pack_saturate (const simd<T,N> &a, const simd<T,N> &b)
+        { return concat(convert_saturate<U>(a), convert_saturate<U>(b)); }
+
+// Native pack instructions, the 256 and 512 bit versions work per lane and need a final permutation
+#if defined (__SSE2__)
+template<> inline simd<int8_t,16> pack_saturate<int8_t> (const simd<int16_t,8> &a, const simd<int16_t,8> &b) { return (simd<int8_t,16>::aligned) _mm_packs_epi16((__m128i) a.r, (__m128i) b.r); }
+template<> inline simd<uint8_t,16> pack_saturate<uint8_t> (const simd<int16_t,8> &a, const simd<int16_t,8> &b) { return (simd<uint8_t,16>::aligned) _mm_packus_epi16((__m128i) a.r, (__m128i) b.r); }
+template<> inline simd<int16_t,8> pack_saturate<int16_t> (const simd<int32_t,4> &a, const simd<int32_t,4> &b) { return (simd<int16_t,8>::aligned) _mm_packs_epi32((__m128i) a.r, (__m128i) b.r); }
+#if defined (__SSE4_1__)
+template<> inline simd<uint16_t,8> pack_saturate<uint16_t> (const simd<int32_t,4> &a, const simd<int32_t,4> &b) { return (simd<uint16_t,8>::aligned) _mm_packus_epi32((__m128i) a.r, (__m128i) b.r); }
+#endif
+#endif
+
+#if defined (__AVX2__)
+template<> inline simd<int8_t,32> pack_saturate<int8_t> (const simd<int16_t,16> &a, const simd<int16_t,16> &b) { return (simd<int8_t,32>::aligned) _mm256_permute4x64_epi64(_mm256_packs_epi16((__m256i) a.r, (__m256i) b.r), 0xD8); }
+template<> inline simd<uint8_t,32> pack_saturate<uint8_t> (const simd<int16_t,16> &a, const simd<int16_t,16> &b) { return (simd<uint8_t,32>::aligned) _mm256_permute4x64_epi64(_mm256_packus_epi16((__m256i) a.r, (__m256i) b.r), 0xD8); }
+template<> inline simd<int16_t,16> pack_saturate<int16_t> (const simd<int32_t,8> &a, const simd<int32_t,8> &b) { return (simd<int16_t,16>::aligned) _mm256_permute4x64_epi64(_mm256_packs_epi32((__m256i) a.r, (__m256i) b.r), 0xD8); }
+template<> inline simd<uint16_t,16> pack_saturate<uint16_t> (const simd<int32_t,8> &a, const simd<int32_t,8> &b) { return (simd<uint16_t,16>::aligned) _mm256_permute4x64_epi64(_mm256_packus_epi32((__m256i) a.r, (__m256i) b.r), 0xD8); }
+#endif
+
+#if defined (__AVX512BW__)
+template<> inline simd<int8_t,64> pack_saturate<int8_t> (const simd<int16_t,32> &a, const simd<int16_t,32> &b) { return (simd<int8_t,64>::aligned) _mm512_maskz_permutexvar_epi64(-1, _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7), _mm512_packs_epi16((__m512i) a.r, (__m512i) b.r)); }
+template<> inline simd<uint8_t,64> pack_saturate<uint8_t> (const simd<int16_t,32> &a, const simd<int16_t,32> &b) { return (simd<uint8_t,64>::aligned) _mm512_maskz_permutexvar_epi64(-1, _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7), _mm512_packus_epi16((__m512i) a.r, (__m512i) b.r)); }
+template<> inline simd<int16_t,32> pack_saturate<int16_t> (const simd<int32_t,16> &a, const simd<int32_t,16> &b) { return (simd<int16_t,32>::aligned) _mm512_maskz_permutexvar_epi64(-1, _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7), _mm512_packs_epi32((__m512i) a.r, (__m512i) b.r)); }
+template<> inline simd<uint16_t,32> pack_saturate<uint16_t> (const simd<int32_t,16> &a, const simd<int32_t,16> &b) { return (simd<uint16_t,32>::aligned) _mm512_maskz_permutexvar_epi64(-1, _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7), _mm512_packus_epi32((__m512i) a.r, (__m512i) b.r)); }
+#endif
+
+// Rounding modes of round_to and convert, round_nearest rounds halfway cases to even
+enum simd_rounding { round_nearest, round_floor, round_ceil, round_trunc };
+
+// Rounding to integer values of floating point objects. The generic version rounds values
+// below 2^digits through integer conversion, larger ones are already integers.
+template<class T, unsigned int N, simd_rounding M>
+    inline simd<T,N> round_to (const simd<T,N> &s, std::integral_constant<simd_rounding, M>, std::true_type)
+    {
+        typedef typename simd<T,N>::int_type I;
+
+        constexpr T big = T(uint64_t(1) << (std::numeric_limits<T>::digits - 1));
+
+        I small = (s < big) & (s > -big);
+        I i = blend(small, s, T(0));
+        simd<T,N> f = blend(small, s, T(0)) - simd<T,N>(i);
+
+        I odd  = (i & 1) != 0;
+        I up   = M == round_ceil ? I(f > T(0)) : (f > T(0.5)) | ((f == T(0.5)) & odd);
+        I down = M == round_floor ? I(f < T(0)) : (f < T(-0.5)) | ((f == T(-0.5)) & odd);
+
+        I r = M == round_trunc ? i : M == round_floor ? i + down : M == round_ceil ? i - up : i - up + down;
+        return blend(small, r, s);
+    }
+
+template<class T, unsigned int N, simd_rounding M>
+    inline simd<T,N> round_to (const simd<T,N> &s, std::integral_constant<simd_rounding, M>, std::false_type) { return s; }
+
+template<class T, unsigned int N, simd_rounding M>
+    inline simd<T,N> round_to (const simd<T,N> &s, std::integral_constant<simd_rounding, M> m) { return round_to(s, m, std::is_floating_point<T>()); }
+
+// Native rounding instructions (vroundps, vroundpd, vrndscaleps, vrndscalepd)
+#if defined (__SSE4_1__)
+constexpr int rounding_imm (simd_rounding m) 
+    { return (m == round_nearest ? _MM_FROUND_TO_NEAREST_INT : m == round_floor ? _MM_FROUND_TO_NEG_INF : m == round_ceil ? _MM_FROUND_TO_POS_INF : _MM_FROUND_TO_ZERO) | _MM_FROUND_NO_EXC; }
+
+template<simd_rounding M> inline simd<float,4>  round_to (const simd<float,4>  &s, std::integral_constant<simd_rounding, M>) { return (simd<float,4>::aligned)  _mm_round_ps((__m128)  s.r, rounding_imm(M)); }
+template<simd_rounding M> inline simd<double,2> round_to (const simd<double,2> &s, std::integral_constant<simd_rounding, M>) { return (simd<double,2>::aligned) _mm_round_pd((__m128d) s.r, rounding_imm(M)); }
+#endif
+
+#if defined (__AVX__)
+template<simd_rounding M> inline simd<float,8>  round_to (const simd<float,8>  &s, std::integral_constant<simd_rounding, M>) { return (simd<float,8>::aligned)  _mm256_round_ps((__m256)  s.r, rounding_imm(M)); }
+template<simd_rounding M> inline simd<double,4> round_to (const simd<double,4> &s, std::integral_constant<simd_rounding, M>) { return (simd<double,4>::aligned) _mm256_round_pd((__m256d) s.r, rounding_imm(M)); }
+#endif
+
+#if defined (__AVX512F__)
+template<simd_rounding M> inline simd<float,16> round_to (const simd<float,16> &s, std::integral_constant<simd_rounding, M>) { return (simd<float,16>::aligned) _mm512_mask_roundscale_ps((__m512)  s.r, 0xFFFF, (__m512)  s.r, rounding_imm(M)); }
+template<simd_rounding M> inline simd<double,8> round_to (const simd<double,8> &s, std::integral_constant<simd_rounding, M>) { return (simd<double,8>::aligned) _mm512_mask_roundscale_pd((__m512d) s.r, 0xFF,   (__m512d) s.r, rounding_imm(M)); }
+#endif
+
+template<simd_rounding M, class T, unsigned int N>
+    inline simd<T,N> round_to (const simd<T,N> &s) { return round_to(s, std::integral_constant<simd_rounding, M>()); }
+
+// Conversion with explicit rounding, e.g. convert<int32_t, round_floor>(x). Values out of
+// the range of U give unspecified results as with the conversion constructor.
+template<class U, simd_rounding M, class T, unsigned int N>
+    inline simd<U,N> convert (const simd<T,N> &s) { return round_to<M>(s); }
+
+// Half precision and bfloat16 storage types, they hold the raw bits and are converted
+// to and from simd<float,N> objects by load_as and store_as
+struct float16  { uint16_t bits; };
+struct bfloat16 { uint16_t bits; };
+
+// Conversions of IEEE half precision bits, rounding to nearest even
+template<unsigned int N>
+    inline simd<float,N> half_to_float (const simd<uint16_t,N> &h)
+    {
+        typedef simd<uint32_t,N> U;
+
+        U em = widen(h & uint16_t(0x7FFF));
+        U s  = widen(h & uint16_t(0x8000)) << 16u;
+
+        // Rebias the exponent, infinities and NaN get the largest one and NaN are made quiet
+        // as by vcvtph2ps
+        U r = (em << 13u) + 0x38000000u;
+        r += U(em >= 0x7C00u) & 0x38000000u;
+        r |= U(em > 0x7C00u) & 0x00400000u;
+
+        // Subnormal numbers are the mantissa times 2^-24, the product is a normal float so
+        // that it is not flushed to zero when denormals are disabled (-Ofast)
+        r = blend(em < 0x0400u, reinterpret<uint32_t>(simd<float,N>(simd<int32_t,N>(em)) * (1.0f / 0x1000000)), r);
+
+        return reinterpret<float>(r | s);
+    }
+
+template<unsigned int N>
+    inline simd<uint16_t,N> float_to_half (const simd<float,N> &f)
+    {
+        typedef simd<uint32_t,N> U;
+
+        U u = reinterpret<uint32_t>(f);
+        U s = u & 0x80000000u;
+        u ^= s;
+
+        // Overflow to infinity, NaN become quiet NaN with the upper bits of their payload
+        U inf = blend(u > 0x7F800000u, ((u >> 13u) & 0x3FFu) | 0x7E00u, 0x7C00u);
+
+        // Subnormal results, the addition aligns the mantissa and rounds it
+        U sub = reinterpret<uint32_t>(reinterpret<float>(u) + 0.5f) - 0x3F000000u;
+
+        // Normal results, rebias the exponent and round to nearest even
+        U nor = (u + 0xC8000FFFu + ((u >> 13u) & 1u)) >> 13u;
+
+        U r = blend(u >= 0x47800000u, inf, blend(u < 0x38800000u, sub, nor));
+        return (r | (s >> 16u));
+    }
+
+#if defined (__F16C__)
+inline simd<float,4>    half_to_float (const simd<uint16_t,4> &h) { return (simd<float,4>::aligned) _mm_cvtph_ps((__m128i) concat(h, h).r); }
+inline simd<float,8>    half_to_float (const simd<uint16_t,8> &h) { return (simd<float,8>::aligned) _mm256_cvtph_ps((__m128i) h.r); }
+inline simd<uint16_t,4> float_to_half (const simd<float,4>    &f) { return lo_half(simd<uint16_t,8>((simd<uint16_t,8>::aligned) _mm_cvtps_ph((__m128) f.r, _MM_FROUND_TO_NEAREST_INT))); }
+inline simd<uint16_t,8> float_to_half (const simd<float,8>    &f) { return (simd<uint16_t,8>::aligned) _mm256_cvtps_ph((__m256) f.r, _MM_FROUND_TO_NEAREST_INT); }
+#endif
+
+#if defined (__AVX512F__)
+inline simd<float,16>    half_to_float (const simd<uint16_t,16> &h) { return (simd<float,16>::aligned) _mm512_maskz_cvtph_ps(0xFFFF, (__m256i) h.r); }
+inline simd<uint16_t,16> float_to_half (const simd<float,16>    &f) { return (simd<uint16_t,16>::aligned) _mm512_maskz_cvtps_ph(0xFFFF, (__m512) f.r, _MM_FROUND_TO_NEAREST_INT); }
+#endif
+
+// Conversions of bfloat16 bits, that are the upper half of a float. Subnormal floats become
+// zero with the sign kept, as with the native instructions (vcvtneps2bf16).
+template<unsigned int N>
+    inline simd<float,N> bfloat_to_float (const simd<uint16_t,N> &h) { return reinterpret<float>(widen(h) << 16u); }
+
+template<unsigned int N>
+    inline simd<uint16_t,N> bfloat_from_float (const simd<float,N> &f)
+    {
+        typedef simd<uint32_t,N> U;
+
+        U u = reinterpret<uint32_t>(f);
+        U a = u & 0x7FFFFFFFu;
+
+        // NaN found from the bits, f != f is folded to false by -ffinite-math-only
+        U r = blend(a > 0x7F800000u, u | 0x00400000u, u + 0x7FFFu + ((u >> 16u) & 1u));
+        r = blend(a < 0x00800000u, u & 0x80000000u, r);
+
+        return r >> 16u;
+    }
+
+#if defined (__AVX512BF16__)
+inline simd<uint16_t,16> bfloat_from_float (const simd<float,16> &f) { return (simd<uint16_t,16>::aligned) (__m256i) _mm512_cvtneps_pbh((__m512) f.r); }
+#if defined (__AVX512VL__)
+inline simd<uint16_t,8>  bfloat_from_float (const simd<float,8>  &f) { return (simd<uint16_t,8>::aligned)  (__m128i) _mm256_cvtneps_pbh((__m256) f.r); }
+#endif
+#endif
+
+// Loads and stores of N elements converted from and to the storage types
+template<class T, unsigned int N> inline simd<T,N> load_as (const float16  *p) { return half_to_float  (simd<uint16_t,N>::loadu(&p->bits)); }
+template<class T, unsigned int N> inline simd<T,N> load_as (const bfloat16 *p) { return bfloat_to_float(simd<uint16_t,N>::loadu(&p->bits)); }
+
+template<class T, unsigned int N> inline void store_as (float16  *p, const simd<T,N> &s) { float_to_half    (simd<float,N>(s)).storeu(&p->bits); }
+template<class T, unsigned int N> inline void store_as (bfloat16 *p, const simd<T,N> &s) { bfloat_from_float(simd<float,N>(s)).storeu(&p->bits); }
+
+// Number of bits set in each byte, with SSSE3 using a lookup table of nibbles
+template<unsigned int N>
+    inline simd<uint8_t,N> popcount_bytes (const simd<uint8_t,N> &b, std::false_type)
+    {
+        simd<uint8_t,N> x = b - ((b >> uint8_t(1)) & uint8_t(0x55));
+        x = (x & uint8_t(0x33)) + ((x >> uint8_t(2)) & uint8_t(0x33));
+        return (x + (x >> uint8_t(4))) & uint8_t(0x0F);
+    }
+
+template<unsigned int N>
+    inline simd<uint8_t,N> popcount_bytes (const simd<uint8_t,N> &b, std::true_type)
+    {
+        const simd<uint8_t,16> bits = {0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4};
+        return lookup16(bits, b & uint8_t(15)) + lookup16(bits, b >> uint8_t(4));
+    }
+
+template<unsigned int N>
+    inline simd<uint8_t,N> popcount_bytes (const simd<uint8_t,N> &b)
+    {
+    #if defined (__SSSE3__)
+        return popcount_bytes(b, std::integral_constant<bool, N % 16 == 0>());
+    #else
+        return popcount_bytes(b, std::false_type());
+    #endif
+    }
+
+// Bit operations on unsigned lanes, the public functions below accept any integer type
+template<class T, unsigned int N>
+    inline simd<T,N> popcount_lanes (const simd<T,N> &s)
+    {
+        simd<T,N> x = reinterpret<T>(popcount_bytes(reinterpret<uint8_t>(s)));
+
+        for (unsigned int i = 8; i < 8 * sizeof(T); i *= 2)
+            x += x >> T(i);
+
+        return x & T(0xFF);
+    }
+
+template<class T, unsigned int N>
+    inline simd<T,N> countl_zero_lanes (const simd<T,N> &s)
+    {
+        simd<T,N> x = s;
+
+        for (unsigned int i = 1; i < 8 * sizeof(T); i *= 2)
+            x |= x >> T(i);
+
+        return popcount_lanes(simd<T,N>(~x));
+    }
+
+// Native instructions of AVX-512 BITALG, VPOPCNTDQ and CD
+#if defined (__AVX512BITALG__) && defined (__AVX512BW__)
+inline simd<uint8_t,64>  popcount_lanes (const simd<uint8_t,64>  &s) { return (simd<uint8_t,64>::aligned)  _mm512_popcnt_epi8 ((__m512i) s.r); }
+inline simd<uint16_t,32> popcount_lanes (const simd<uint16_t,32> &s) { return (simd<uint16_t,32>::aligned) _mm512_popcnt_epi16((__m512i) s.r); }
+#if defined (__AVX512VL__)
+inline simd<uint8_t,16>  popcount_lanes (const simd<uint8_t,16>  &s) { return (simd<uint8_t,16>::aligned)  _mm_popcnt_epi8    ((__m128i) s.r); }
+inline simd<uint8_t,32>  popcount_lanes (const simd<uint8_t,32>  &s) { return (simd<uint8_t,32>::aligned)  _mm256_popcnt_epi8 ((__m256i) s.r); }
+inline simd<uint16_t,8>  popcount_lanes (const simd<uint16_t,8>  &s) { return (simd<uint16_t,8>::aligned)  _mm_popcnt_epi16   ((__m128i) s.r); }
+inline simd<uint16_t,16> popcount_lanes (const simd<uint16_t,16> &s) { return (simd<uint16_t,16>::aligned) _mm256_popcnt_epi16((__m256i) s.r); }
+#endif
+#endif
+
+#if defined (__AVX512VPOPCNTDQ__)
+inline simd<uint32_t,16> popcount_lanes (const simd<uint32_t,16> &s) { return (simd<uint32_t,16>::aligned) _mm512_popcnt_epi32((__m512i) s.r); }
+inline simd<uint64_t,8>  popcount_lanes (const simd<uint64_t,8>  &s) { return (simd<uint64_t,8>::aligned)  _mm512_popcnt_epi64((__m512i) s.r); }
+#if defined (__AVX512VL__)
+inline simd<uint32_t,4>  popcount_lanes (const simd<uint32_t,4>  &s) { return (simd<uint32_t,4>::aligned)  _mm_popcnt_epi32   ((__m128i) s.r); }
+inline simd<uint32_t,8>  popcount_lanes (const simd<uint32_t,8>  &s) { return (simd<uint32_t,8>::aligned)  _mm256_popcnt_epi32((__m256i) s.r); }
+inline simd<uint64_t,2>  popcount_lanes (const simd<uint64_t,2>  &s) { return (simd<uint64_t,2>::aligned)  _mm_popcnt_epi64   ((__m128i) s.r); }
+inline simd<uint64_t,4>  popcount_lanes (const simd<uint64_t,4>  &s) { return (simd<uint64_t,4>::aligned)  _mm256_popcnt_epi64((__m256i) s.r); }
+#endif
+#endif
+
+// Bytes of 64-bit lanes summed with vpsadbw when the native count is missing
+#if defined (__SSE2__) && !(defined (__AVX512VPOPCNTDQ__) && defined (__AVX512VL__))
+inline simd<uint64_t,2>  popcount_lanes (const simd<uint64_t,2>  &s) { return (simd<uint64_t,2>::aligned)  _mm_sad_epu8   ((__m128i) popcount_bytes(reinterpret<uint8_t>(s)).r, _mm_setzero_si128()); }
+#if defined (__AVX2__)
+inline simd<uint64_t,4>  popcount_lanes (const simd<uint64_t,4>  &s) { return (simd<uint64_t,4>::aligned)  _mm256_sad_epu8((__m256i) popcount_bytes(reinterpret<uint8_t>(s)).r, _mm256_setzero_si256()); }
+#endif
+#endif
+
+#if defined (__AVX512CD__)
+inline simd<uint32_t,16> countl_zero_lanes (const simd<uint32_t,16> &s) { return (simd<uint32_t,16>::aligned) _mm512_lzcnt_epi32((__m512i) s.r); }
+inline simd<uint64_t,8>  countl_zero_lanes (const simd<uint64_t,8>  &s) { return (simd<uint64_t,8>::aligned)  _mm512_lzcnt_epi64((__m512i) s.r); }
+#if defined (__AVX512VL__)
+inline simd<uint32_t,4>  countl_zero_lanes (const simd<uint32_t,4>  &s) { return (simd<uint32_t,4>::aligned)  _mm_lzcnt_epi32   ((__m128i) s.r); }
+inline simd<uint32_t,8>  countl_zero_lanes (const simd<uint32_t,8>  &s) { return (simd<uint32_t,8>::aligned)  _mm256_lzcnt_epi32((__m256i) s.r); }
+inline simd<uint64_t,2>  countl_zero_lanes (const simd<uint64_t,2>  &s) { return (simd<uint64_t,2>::aligned)  _mm_lzcnt_epi64   ((__m128i) s.r); }
+inline simd<uint64_t,4>  countl_zero_lanes (const simd<uint64_t,4>  &s) { return (simd<uint64_t,4>::aligned)  _mm256_lzcnt_epi64((__m256i) s.r); }
+#endif
+#endif
+
+// Number of bits set, of leading and of trailing zero bits (all bits for zero) as in <bit>
+template<class T, unsigned int N, class U = simd<std::make_unsigned_t<T>,N>> inline simd<T,N> popcount    (const simd<T,N> &s) { return popcount_lanes(U(s)); }
+template<class T, unsigned int N, class U = simd<std::make_unsigned_t<T>,N>> inline simd<T,N> countl_zero (const simd<T,N> &s) { return countl_zero_lanes(U(s)); }
+template<class T, unsigned int N, class U = simd<std::make_unsigned_t<T>,N>> inline simd<T,N> countr_zero (const simd<T,N> &s) { U x = s; return popcount_lanes(U(~x & (x - 1u))); }
+
+// Bit rotations by a scalar or by a different amount for each lane
+template<class T, unsigned int N, class V, class U = simd<std::make_unsigned_t<T>,N>>
+    inline simd<T,N> rotl (const simd<T,N> &s, const V &k)
+    {
+        U x = s, n = k, m = 8 * sizeof(T) - 1;
+        return (x << (n & m)) | (x >> (-n & m));
+    }
+
+template<class T, unsigned int N, class V, class U = simd<std::make_unsigned_t<T>,N>>
+    inline simd<T,N> rotr (const simd<T,N> &s, const V &k)
+    {
+        U x = s, n = k, m = 8 * sizeof(T) - 1;
+        return (x >> (n & m)) | (x << (-n & m));
+    }
+
+// Order of the bytes reversed in each lane
+template<class T, unsigned int N, int... I>
+    inline simd<T,N> byteswap (const simd<T,N> &s, std::integer_sequence<int, I...>)
+        { return reinterpret<T>(permute<(I ^ int(sizeof(T) - 1))...>(reinterpret<uint8_t>(s))); }
+
+template<class T, unsigned int N>
+    inline simd<T,N> byteswap (const simd<T,N> &s)
+        { return byteswap(s, std::make_integer_sequence<int, N * sizeof(T)>()); }
+
+// Order of the bits reversed in each lane
+template<unsigned int N>
+    inline simd<uint8_t,N> bit_reverse_bytes (const simd<uint8_t,N> &b, std::false_type)
+    {
+        simd<uint8_t,N> x = (b >> uint8_t(4)) | (b << uint8_t(4));
+        x = ((x >> uint8_t(2)) & uint8_t(0x33)) | ((x & uint8_t(0x33)) << uint8_t(2));
+        return ((x >> uint8_t(1)) & uint8_t(0x55)) | ((x & uint8_t(0x55)) << uint8_t(1));
+    }
+
+template<unsigned int N>
+    inline simd<uint8_t,N> bit_reverse_bytes (const simd<uint8_t,N> &b, std::true_type)
+    {
+        const simd<uint8_t,16> lo = {0x00,0x80,0x40,0xC0,0x20,0xA0,0x60,0xE0,0x10,0x90,0x50,0xD0,0x30,0xB0,0x70,0xF0};
+        const simd<uint8_t,16> hi = {0x00,0x08,0x04,0x0C,0x02,0x0A,0x06,0x0E,0x01,0x09,0x05,0x0D,0x03,0x0B,0x07,0x0F};
+        return lookup16(lo, b & uint8_t(15)) | lookup16(hi, b >> uint8_t(4));
+    }
+
+template<class T, unsigned int N>
+    inline simd<T,N> bit_reverse (const simd<T,N> &s)
+    {
+        simd<uint8_t, N * sizeof(T)> b = reinterpret<uint8_t>(byteswap(s));
+    #if defined (__SSSE3__)
+        return reinterpret<T>(bit_reverse_bytes(b, std::integral_constant<bool, N * sizeof(T) % 16 == 0>()));
+    #else
+        return reinterpret<T>(bit_reverse_bytes(b, std::false_type()));
+    #endif
+    }
+
+// Full products in lanes twice larger. The 32-bit lanes are moved to the even positions
+// and multiplied with vpmuludq or vpmuldq, the smaller ones are widened and multiplied.
+template<class T, unsigned int N, int... I>
+    inline simd<wider_t<T>,N> mul_wide (const simd<T,N> &a, const simd<T,N> &b, std::integer_sequence<int, I...>, std::true_type)
+    {
+        return concat(mul_even(permute<(I / 2)...>(a), permute<(I / 2)...>(b)),
+                      mul_even(permute<(I / 2 + int(N) / 2)...>(a), permute<(I / 2 + int(N) / 2)...>(b)));
+    }
+
+template<class T, unsigned int N, int... I>
+    inline simd<wider_t<T>,N> mul_wide (const simd<T,N> &a, const simd<T,N> &b, std::integer_sequence<int, I...>, std::false_type)
+    {
+        return widen(a) * widen(b);
+    }
+
+template<class T, unsigned int N>
+    inline simd<wider_t<T>,N> mul_wide (const simd<T,N> &a, const simd<T,N> &b)
+    {
+        static_assert(std::is_integral<T>::value && sizeof(T) < 8, "unsupported type");
+        return mul_wide(a, b, std::make_integer_sequence<int, N>(), std::integral_constant<bool, sizeof(T) == 4 && N % 2 == 0>());
+    }
+
+// Lower half of the products as operator *, 64-bit lanes use vpmullq of AVX-512DQ.
+// Without it they are made of three vpmuludq as GCC already does.
+template<class T, unsigned int N> inline simd<T,N> mullo (const simd<T,N> &a, const simd<T,N> &b) { return a * b; }
+
+#if defined (__AVX512DQ__)
+inline simd<int64_t,8>  mullo (const simd<int64_t,8>  &a, const simd<int64_t,8>  &b) { return (simd<int64_t,8>::aligned)  _mm512_maskz_mullo_epi64(-1, (__m512i) a.r, (__m512i) b.r); }
+inline simd<uint64_t,8> mullo (const simd<uint64_t,8> &a, const simd<uint64_t,8> &b) { return (simd<uint64_t,8>::aligned) _mm512_maskz_mullo_epi64(-1, (__m512i) a.r, (__m512i) b.r); }
+#if defined (__AVX512VL__)
+inline simd<int64_t,2>  mullo (const simd<int64_t,2>  &a, const simd<int64_t,2>  &b) { return (simd<int64_t,2>::aligned)  _mm_maskz_mullo_epi64   (-1, (__m128i) a.r, (__m128i) b.r); }
+inline simd<uint64_t,2> mullo (const simd<uint64_t,2> &a, const simd<uint64_t,2> &b) { return (simd<uint64_t,2>::aligned) _mm_maskz_mullo_epi64   (-1, (__m128i) a.r, (__m128i) b.r); }
+inline simd<int64_t,4>  mullo (const simd<int64_t,4>  &a, const simd<int64_t,4>  &b) { return (simd<int64_t,4>::aligned)  _mm256_maskz_mullo_epi64(-1, (__m256i) a.r, (__m256i) b.r); }
+inline simd<uint64_t,4> mullo (const simd<uint64_t,4> &a, const simd<uint64_t,4> &b) { return (simd<uint64_t,4>::aligned) _mm256_maskz_mullo_epi64(-1, (__m256i) a.r, (__m256i) b.r); }
+#endif
+#endif
+
+// Division by a divisor known only at run time but used many times, replaced by a multiply 
+// high and shifts with the magic numbers of Granlund and Montgomery (as libdivide). Lanes up 
+// to 32 bits are supported, the divisor must not be zero.
+template<class T>
+    class simd_divider
+    {
+        static_assert(std::is_integral<T>::value && sizeof(T) <= 4, "unsupported type");
+
+        static constexpr unsigned int bits = 8 * sizeof(T);
+
+        typedef std::make_unsigned_t<T> U;
+
+        // Smallest l such that 2^l >= x
+        static unsigned int log2_ceil (uint64_t x) { unsigned int l = 0; while ((uint64_t(1) << l) < x) l++; return l; }
+
+    public:
+        // Divisor and parameters of the division
+        T divisor, multiplier;
+        unsigned int shift1, shift2;
+
+        simd_divider (T d) : divisor(d)
+        {
+            if (std::is_signed<T>::value)
+            {
+                uint64_t a = d < 0 ? uint64_t(-int64_t(d)) : uint64_t(d);
+                unsigned int l = a > 1 ? log2_ceil(a) : 1;
+
+                multiplier = T(U(1 + (uint64_t(1) << (bits + l - 1)) / a));
+                shift1 = l - 1;
+                shift2 = 0;
+            }
+            else
+            {
+                unsigned int l = log2_ceil(uint64_t(d));
+
+                multiplier = T((uint64_t(1) << bits) * ((uint64_t(1) << l) - d) / d + 1);
+                shift1 = l > 0;
+                shift2 = l - shift1;
+            }
+        }
+
+        template<unsigned int N>
+            inline simd<T,N> divide (const simd<T,N> &n, std::false_type) const
+            {
+                simd<T,N> t = mulhi(n, simd<T,N>(multiplier));
+                return (t + ((n - t) >> T(shift1))) >> T(shift2);
+            }
+
+        // The sums wrap around (INT_MIN / 1), so they are made with unsigned lanes and
+        // only the shift is signed
+        template<unsigned int N>
+            inline simd<T,N> divide (const simd<T,N> &n, std::true_type) const
+            {
+                simd<U,N> q = reinterpret<U>(n) + reinterpret<U>(mulhi(n, simd<T,N>(multiplier)));
+                simd<U,N> s = U(divisor >> (bits - 1));
+
+                q = reinterpret<U>(reinterpret<T>(q) >> T(shift1)) - reinterpret<U>(n >> T(bits - 1));
+                return reinterpret<T>((q ^ s) - s);
+            }
+
+        template<unsigned int N>
+            inline simd<T,N> divide (const simd<T,N> &n) const { return divide(n, std::is_signed<T>()); }
+    };
+
+template<class T, unsigned int N> inline simd<T,N> operator / (const simd<T,N> &n, const simd_divider<T> &d) { return d.divide(n); }
+template<class T, unsigned int N, class U = std::make_unsigned_t<T>>
+    inline simd<T,N> operator % (const simd<T,N> &n, const simd_divider<T> &d) { return reinterpret<T>(reinterpret<U>(n) - reinterpret<U>(d.divide(n)) * U(d.divisor)); }
+
+// Index of each lane (0,1,2,...) as elements of type T
+template<class T, unsigned int N, int... I>
+    constexpr simd<T,N> lane_index (std::integer_sequence<int, I...>) { return simd<T,N>(T(I)...); }
+
+template<class T, unsigned int N>
+    constexpr simd<T,N> lane_index () { return lane_index<T,N>(std::make_integer_sequence<int, N>()); }
+
+// Reduction of all the lanes by op with log2(N) rotations, every lane of the result holds
+// it. Unlike reduce the function is applied to whole objects, N must be a power of two.
+template<class T, unsigned int N, class F>
+    inline simd<T,N> reduce_lanes (const simd<T,N> &s, const F &, std::integral_constant<unsigned int, 0>) { return s; }
+
+template<class T, unsigned int N, class F, unsigned int K>
+    inline simd<T,N> reduce_lanes (const simd<T,N> &s, const F &op, std::integral_constant<unsigned int, K>)
+        { return reduce_lanes(simd<T,N>(op(s, rotate_lanes<K>(s))), op, std::integral_constant<unsigned int, K/2>()); }
+
+template<class T, unsigned int N, class F>
+    inline simd<T,N> reduce_lanes (const simd<T,N> &s, const F &op)
+        { static_assert((N & (N - 1)) == 0, "size not a power of two"); return reduce_lanes(s, op, std::integral_constant<unsigned int, N/2>()); }
+
+// Barrier to the reassociation of floating point operations allowed by -ffast-math, that 
+// would simplify away the error terms of the error-free transformations below
+#if defined (__has_builtin)
+#if __has_builtin(__builtin_assoc_barrier)
+#define _simd_assoc_barrier_(x) __builtin_assoc_barrier(x)
+#elif __has_builtin(__arithmetic_fence)
+#define _simd_assoc_barrier_(x) __arithmetic_fence(x)
+#endif
+#endif
+
+#ifndef _simd_assoc_barrier_
+#define _simd_assoc_barrier_(x) (x)
+#endif
+
+// Error-free transformations, a + b and a * b are the sum of the rounded result (first) 
+// and of its exact error (second). two_sum is the algorithm of Knuth, two_prod splits the
+// factors in halves as Dekker when FMA instructions are missing.
+template<class T, unsigned int N>
+    inline std::pair<simd<T,N>, simd<T,N> > two_sum (const simd<T,N> &a, const simd<T,N> &b)
+    {
+        typename simd<T,N>::aligned s = _simd_assoc_barrier_(a.r + b.r);
+        typename simd<T,N>::aligned z = _simd_assoc_barrier_(s - a.r);
+
+        return { s, _simd_assoc_barrier_(a.r - _simd_assoc_barrier_(s - z)) + _simd_assoc_barrier_(b.r - z) };
+    }
+
+template<class T, unsigned int N>
+    inline std::pair<simd<T,N>, simd<T,N> > two_prod (const simd<T,N> &a, const simd<T,N> &b)
+    {
+        typedef typename simd<T,N>::aligned V;
+
+        // Splitter of Veltkamp, 2^ceil(digits / 2) + 1
+        constexpr T f = T((int64_t(1) << ((std::numeric_limits<T>::digits + 1) / 2)) + 1);
+
+        V p  = a.r * b.r;
+        V ca = _simd_assoc_barrier_(f * a.r), ah = _simd_assoc_barrier_(ca - _simd_assoc_barrier_(ca - a.r)), al = a.r - ah;
+        V cb = _simd_assoc_barrier_(f * b.r), bh = _simd_assoc_barrier_(cb - _simd_assoc_barrier_(cb - b.r)), bl = b.r - bh;
+
+        return { p, _simd_assoc_barrier_(_simd_assoc_barrier_(_simd_assoc_barrier_(ah * bh - p) + ah * bl) + al * bh) + al * bl };
+    }
+
+#if defined (__FMA__)
+inline std::pair<simd<float,4>,  simd<float,4> >  two_prod (const simd<float,4>  &a, const simd<float,4>  &b) { simd<float,4>  p = a * b; return { p, (simd<float,4>::aligned)  _mm_fmsub_ps   ((__m128)  a.r, (__m128)  b.r, (__m128)  p.r) }; }
+inline std::pair<simd<float,8>,  simd<float,8> >  two_prod (const simd<float,8>  &a, const simd<float,8>  &b) { simd<float,8>  p = a * b; return { p, (simd<float,8>::aligned)  _mm256_fmsub_ps((__m256)  a.r, (__m256)  b.r, (__m256)  p.r) }; }
+inline std::pair<simd<double,2>, simd<double,2> > two_prod (const simd<double,2> &a, const simd<double,2> &b) { simd<double,2> p = a * b; return { p, (simd<double,2>::aligned) _mm_fmsub_pd   ((__m128d) a.r, (__m128d) b.r, (__m128d) p.r) }; }
+inline std::pair<simd<double,4>, simd<double,4> > two_prod (const simd<double,4> &a, const simd<double,4> &b) { simd<double,4> p = a * b; return { p, (simd<double,4>::aligned) _mm256_fmsub_pd((__m256d) a.r, (__m256d) b.r, (__m256d) p.r) }; }
+#endif
+
+#if defined (__AVX512F__)
+inline std::pair<simd<float,16>, simd<float,16> > two_prod (const simd<float,16> &a, const simd<float,16> &b) { simd<float,16> p = a * b; return { p, (simd<float,16>::aligned) _mm512_fmsub_ps((__m512)  a.r, (__m512)  b.r, (__m512)  p.r) }; }
+inline std::pair<simd<double,8>, simd<double,8> > two_prod (const simd<double,8> &a, const simd<double,8> &b) { simd<double,8> p = a * b; return { p, (simd<double,8>::aligned) _mm512_fmsub_pd((__m512d) a.r, (__m512d) b.r, (__m512d) p.r) }; }
+#endif
+
+// Sum of the lanes of s plus the error terms e with the cascaded summation of Ogita, Rump 
+// and Oishi, the result is as accurate as if computed with twice the precision of T
+template<class T, unsigned int N>
+    inline T sum_compensated (const simd<T,N> &s, const simd<T,N> &e = simd<T,N>(0))
+    {
+        simd<T,1> r = s[0], c = e[0];
+
+        for (unsigned int i = 1; i < N; i++)
+        {
+            std::pair<simd<T,1>, simd<T,1> > t = two_sum(r, simd<T,1>(s[i]));
+
+            r = t.first;
+            c = c + (t.second + e[i]);
+        }
+
+        return (r + c)[0];
+    }
+
+// Bit i set when lane i of a mask is true, as vpmovmskb and vmovmskps. Masks of comparisons
+// have all the bits of true lanes set and only the highest one is tested.
+template<class T, unsigned int N>
+    inline uint64_t bitmask_lanes (const simd<T,N> &s) { uint64_t r = 0; for (unsigned int i = 0; i < N; i++) r |= uint64_t(s[i] < 0) << i; return r; }
+
+#if defined (__SSE2__)
+inline uint64_t bitmask_lanes (const simd<int8_t,16>  &s) { return uint32_t(_mm_movemask_epi8((__m128i) s.r)); }
+inline uint64_t bitmask_lanes (const simd<int16_t,8>  &s) { return uint32_t(_mm_movemask_epi8(_mm_packs_epi16((__m128i) s.r, _mm_setzero_si128()))); }
+inline uint64_t bitmask_lanes (const simd<int32_t,4>  &s) { return uint32_t(_mm_movemask_ps((__m128) s.r)); }
+inline uint64_t bitmask_lanes (const simd<int64_t,2>  &s) { return uint32_t(_mm_movemask_pd((__m128d) s.r)); }
+#endif
+
+#if defined (__AVX__)
+inline uint64_t bitmask_lanes (const simd<int32_t,8>  &s) { return uint32_t(_mm256_movemask_ps((__m256) s.r)); }
+inline uint64_t bitmask_lanes (const simd<int64_t,4>  &s) { return uint32_t(_mm256_movemask_pd((__m256d) s.r)); }
+#endif
+
+#if defined (__AVX2__)
+inline uint64_t bitmask_lanes (const simd<int8_t,32>  &s) { return uint32_t(_mm256_movemask_epi8((__m256i) s.r)); }
+inline uint64_t bitmask_lanes (const simd<int16_t,16> &s) { return uint32_t(_mm_movemask_epi8(_mm_packs_epi16((__m128i) lo_half(s).r, (__m128i) hi_half(s).r))); }
+#endif
+
+#if defined (__AVX512BW__)
+inline uint64_t bitmask_lanes (const simd<int8_t,64>  &s) { return _mm512_movepi8_mask ((__m512i) s.r); }
+inline uint64_t bitmask_lanes (const simd<int16_t,32> &s) { return _mm512_movepi16_mask((__m512i) s.r); }
+#endif
+
+#if defined (__AVX512DQ__)
+inline uint64_t bitmask_lanes (const simd<int32_t,16> &s) { return _mm512_movepi32_mask((__m512i) s.r); }
+inline uint64_t bitmask_lanes (const simd<int64_t,8>  &s) { return _mm512_movepi64_mask((__m512i) s.r); }
+#endif
+
+template<class T, unsigned int N>
+    inline uint64_t bitmask (const simd<T,N> &s)
+        { static_assert(N <= 64, "too many lanes"); return bitmask_lanes(reinterpret<typename simd<T,N>::int_type::type>(s)); }
+
+// Sorting networks of Batcher. Each step of the bitonic merge compares lanes i and i ^ J
+// (a permute, std::min and std::max) and takes the smaller one in the lane whose bit J
+// is clear, unless the bit K of the lane index or D reverse the order. Sizes must be
+// powers of two.
+template<unsigned int K, bool D, class T, unsigned int N, int... I>
+    inline simd<T,N> bitonic_merge (const simd<T,N> &s, std::integer_sequence<int, I...>, std::integral_constant<unsigned int, 0>) { return s; }
+
+template<unsigned int K, bool D, class T, unsigned int N, int... I, unsigned int J>
+    inline simd<T,N> bitonic_merge (const simd<T,N> &s, std::integer_sequence<int, I...> q, std::integral_constant<unsigned int, J>)
+    {
+        simd<T,N> p = permute<(I ^ int(J))...>(s);
+        simd<T,N> a = std::min(s, p), b = std::max(s, p);
+
+        return bitonic_merge<K,D>(shuffle<(((I & int(J)) != 0) != (((I & int(K)) != 0) != D) ? I + int(N) : I)...>(a, b), q, std::integral_constant<unsigned int, J/2>());
+    }
+
+template<class T, unsigned int N, int... I>
+    inline simd<T,N> bitonic_sort (const simd<T,N> &s, std::integer_sequence<int, I...>, std::integral_constant<unsigned int, 1>) { return s; }
+
+template<class T, unsigned int N, int... I, unsigned int K>
+    inline simd<T,N> bitonic_sort (const simd<T,N> &s, std::integer_sequence<int, I...> q, std::integral_constant<unsigned int, K>)
+        { return bitonic_merge<K,false>(bitonic_sort(s, q, std::integral_constant<unsigned int, K/2>()), q, std::integral_constant<unsigned int, K/2>()); }
+
+// Networks over the K * N elements of K objects, the element j of rows[r] has index r * N + j. 
+// Steps with J >= N compare whole objects, the others are done inside each object.
+template<unsigned int M, class T, unsigned int N, unsigned int K, int... I, unsigned int J>
+    inline void bitonic_merge (simd<T,N> (&rows)[K], std::integer_sequence<int, I...> q, std::integral_constant<unsigned int, J>, std::false_type)
+    {
+        for (unsigned int r = 0; r < K; r++)
+            rows[r] = (r & (M / N)) ? bitonic_merge<M,true>(rows[r], q, std::integral_constant<unsigned int, J>())
+                                    : bitonic_merge<M,false>(rows[r], q, std::integral_constant<unsigned int, J>());
+    }
+
+template<unsigned int M, class T, unsigned int N, unsigned int K, int... I, unsigned int J>
+    inline void bitonic_merge (simd<T,N> (&rows)[K], std::integer_sequence<int, I...> q, std::integral_constant<unsigned int, J>, std::true_type)
+    {
+        for (unsigned int r = 0; r < K; r++)
+            if (!(r & (J / N)))
+            {
+                simd<T,N> a = std::min(rows[r], rows[r + J / N]);
+                simd<T,N> b = std::max(rows[r], rows[r + J / N]);
+
+                rows[r]         = (r & (M / N)) ? b : a;
+                rows[r + J / N] = (r & (M / N)) ? a : b;
+            }
+
+        bitonic_merge<M>(rows, q, std::integral_constant<unsigned int, J/2>(), std::integral_constant<bool, (J/2 >= N)>());
+    }
+
+template<class T, unsigned int N, unsigned int K, int... I>
+    inline void bitonic_sort (simd<T,N> (&)[K], std::integer_sequence<int, I...>, std::integral_constant<unsigned int, 1>) {}
+
+template<class T, unsigned int N, unsigned int K, int... I, unsigned int M>
+    inline void bitonic_sort (simd<T,N> (&rows)[K], std::integer_sequence<int, I...> q, std::integral_constant<unsigned int, M>)
+    {
+        bitonic_sort(rows, q, std::integral_constant<unsigned int, M/2>());
+        bitonic_merge<M>(rows, q, std::integral_constant<unsigned int, M/2>(), std::integral_constant<bool, (M/2 >= N)>());
+    }
+
+// Lanes of s or elements of rows in ascending order
+template<class T, unsigned int N>
+    inline simd<T,N> sort (const simd<T,N> &s)
+        { static_assert((N & (N - 1)) == 0, "size not a power of two"); return bitonic_sort(s, std::make_integer_sequence<int, N>(), std::integral_constant<unsigned int, N>()); }
+
+template<class T, unsigned int N, unsigned int K>
+    inline void sort (simd<T,N> (&rows)[K])
+    {
+        static_assert((N & (N - 1)) == 0 && (K & (K - 1)) == 0, "size not a power of two");
+        bitonic_sort(rows, std::make_integer_sequence<int, N>(), std::integral_constant<unsigned int, K * N>());
+    }
+
+// Stable partition of the lanes, the ones whose bit is set in b (or whose lane of the mask 
+// m is true) are moved to the front in order and the others follow in order. The generic 
+// version is scalar, natives on unsigned lanes use vpcompressd and vpexpandd of AVX-512 or
+// a permutation read from a table indexed by the bits (vpermd and pshufb).
+template<class T, unsigned int N>
+    inline simd<T,N> partition_unsigned (const simd<T,N> &s, uint64_t b)
+    {
+        T r[N];
+        unsigned int j = 0, k = __builtin_popcountll(b);
+
+        for (unsigned int i = 0; i < N; i++)
+            r[(b >> i & 1) ? j++ : k++] = s[i];
+
+        return simd<T,N>::loadu(r);
+    }
+
+// Lane moved by partition_lanes in position j, when the set bits of b are first
+constexpr unsigned int partition_lane (unsigned int b, unsigned int j, unsigned int N)
+{
+    for (unsigned int i = 0; i < N; i++) if ( (b >> i & 1) && j-- == 0) return i;
+    for (unsigned int i = 0; i < N; i++) if (!(b >> i & 1) && j-- == 0) return i;
+    return 0;
+}
+
+// Permutations of N lanes made of W 32-bit elements, as indexes of 4 bits for vpermd
+template<unsigned int N, unsigned int W>
+    struct partition_table32
+    {
+        uint32_t index[1 << N];
+
+        constexpr partition_table32 () : index()
+        {
+            for (unsigned int b = 0; b < (1u << N); b++)
+                for (unsigned int j = 0; j < N * W; j++)
+                    index[b] |= (W * partition_lane(b, j / W, N) + j % W) << (4 * j);
+        }
+    };
+
+// Permutations of N lanes of a 128-bit object as indexes of the bytes for pshufb
+template<unsigned int N>
+    struct partition_table8
+    {
+        uint8_t index[1 << N][16];
+
+        constexpr partition_table8 () : index()
+        {
+            for (unsigned int b = 0; b < (1u << N); b++)
+                for (unsigned int j = 0; j < 16; j++)
+                    index[b][j] = 16 / N * partition_lane(b, j / (16 / N), N) + j % (16 / N);
+        }
+    };
+
+#if defined (__SSSE3__)
+template<class T, unsigned int N>
+    inline simd<T,N> partition_lanes_pshufb (const simd<T,N> &s, uint64_t b)
+    {
+        static constexpr partition_table8<N> t = partition_table8<N>();
+        return (typename simd<T,N>::aligned) _mm_shuffle_epi8((__m128i) s.r, _mm_loadu_si128((const __m128i *) t.index[b]));
+    }
+
+inline simd<uint16_t,8> partition_unsigned (const simd<uint16_t,8> &s, uint64_t b) { return partition_lanes_pshufb(s, b); }
+#if !defined (__AVX512VL__)
+inline simd<uint32_t,4> partition_unsigned (const simd<uint32_t,4> &s, uint64_t b) { return partition_lanes_pshufb(s, b); }
+inline simd<uint64_t,2> partition_unsigned (const simd<uint64_t,2> &s, uint64_t b) { return partition_lanes_pshufb(s, b); }
+#endif
+#endif
+
+#if defined (__AVX2__) && !defined (__AVX512VL__)
+template<class T, unsigned int N>
+    inline simd<T,N> partition_lanes_vpermd (const simd<T,N> &s, uint64_t b)
+    {
+        static constexpr partition_table32<N, 8 / N> t = partition_table32<N, 8 / N>();
+        __m256i i = _mm256_srlv_epi32(_mm256_set1_epi32(t.index[b]), _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28));
+
+        return (typename simd<T,N>::aligned) _mm256_permutevar8x32_epi32((__m256i) s.r, i);
+    }
+
+inline simd<uint32_t,8> partition_unsigned (const simd<uint32_t,8> &s, uint64_t b) { return partition_lanes_vpermd(s, b); }
+inline simd<uint64_t,4> partition_unsigned (const simd<uint64_t,4> &s, uint64_t b) { return partition_lanes_vpermd(s, b); }
+#endif
+
+#if defined (__AVX512VL__)
+inline simd<uint32_t,4> partition_unsigned (const simd<uint32_t,4> &s, uint64_t b) 
+    { unsigned int c = __builtin_popcountll(b); return (simd<uint32_t,4>::aligned) _mm_mask_expand_epi32   (_mm_maskz_compress_epi32   (b, (__m128i) s.r), 0xFu   << c, _mm_maskz_compress_epi32   (~b, (__m128i) s.r)); }
+inline simd<uint64_t,2> partition_unsigned (const simd<uint64_t,2> &s, uint64_t b) 
+    { unsigned int c = __builtin_popcountll(b); return (simd<uint64_t,2>::aligned) _mm_mask_expand_epi64   (_mm_maskz_compress_epi64   (b, (__m128i) s.r), 0x3u   << c, _mm_maskz_compress_epi64   (~b, (__m128i) s.r)); }
+inline simd<uint32_t,8> partition_unsigned (const simd<uint32_t,8> &s, uint64_t b) 
+    { unsigned int c = __builtin_popcountll(b); return (simd<uint32_t,8>::aligned) _mm256_mask_expand_epi32(_mm256_maskz_compress_epi32(b, (__m256i) s.r), 0xFFu  << c, _mm256_maskz_compress_epi32(~b, (__m256i) s.r)); }
+inline simd<uint64_t,4> partition_unsigned (const simd<uint64_t,4> &s, uint64_t b) 
+    { unsigned int c = __builtin_popcountll(b); return (simd<uint64_t,4>::aligned) _mm256_mask_expand_epi64(_mm256_maskz_compress_epi64(b, (__m256i) s.r), 0xFu   << c, _mm256_maskz_compress_epi64(~b, (__m256i) s.r)); }
+#endif
+
+#if defined (__AVX512F__)
+inline simd<uint32_t,16> partition_unsigned (const simd<uint32_t,16> &s, uint64_t b) 
+    { unsigned int c = __builtin_popcountll(b); return (simd<uint32_t,16>::aligned) _mm512_mask_expand_epi32(_mm512_maskz_compress_epi32(b, (__m512i) s.r), 0xFFFFu << c, _mm512_maskz_compress_epi32(~b, (__m512i) s.r)); }
+inline simd<uint64_t,8>  partition_unsigned (const simd<uint64_t,8>  &s, uint64_t b) 
+    { unsigned int c = __builtin_popcountll(b); return (simd<uint64_t,8>::aligned)  _mm512_mask_expand_epi64(_mm512_maskz_compress_epi64(b, (__m512i) s.r), 0xFFu   << c, _mm512_maskz_compress_epi64(~b, (__m512i) s.r)); }
+#endif
+
+template<class T, unsigned int N>
+    inline simd<T,N> partition_lanes (const simd<T,N> &s, uint64_t b)
+        { return reinterpret<T>(partition_unsigned(reinterpret<std::make_unsigned_t<typename simd<T,N>::int_type::type>>(s), b)); }
+
+template<class T, unsigned int N, class M>
+    inline simd<T,N> partition_lanes (const simd<T,N> &s, const simd<M,N> &m) { return partition_lanes(s, bitmask(m)); }
+
+// Compression of the lanes selected by b or by the mask m to the front, the other lanes are
+// unspecified, and the inverse expansion that moves consecutive elements to the selected 
+// lanes and zeros the others. Natives use vpcompressd and vpexpandd, without AVX-512 the 
+// compression is the permutation of partition_lanes.
+template<class T, unsigned int N> inline simd<T,N> compress_unsigned (const simd<T,N> &s, uint64_t b) { return partition_unsigned(s, b); }
+
+template<class T, unsigned int N>
+    inline simd<T,N> expand_unsigned (const simd<T,N> &s, uint64_t b)
+    {
+        T r[N];
+        unsigned int j = 0;
+
+        for (unsigned int i = 0; i < N; i++)
+            r[i] = (b >> i & 1) ? s[j++] : T(0);
+
+        return simd<T,N>::loadu(r);
+    }
+
+// Expansion of the first elements of p reading only the ones needed
+template<class T, unsigned int N>
+    inline simd<T,N> expand_load_unsigned (const T *p, uint64_t b) { return expand_unsigned(simd<T,N>::loadu(p, __builtin_popcountll(b)), b); }
+
+#if defined (__AVX512VL__)
+inline simd<uint32_t,4>  compress_unsigned (const simd<uint32_t,4>  &s, uint64_t b) { return (simd<uint32_t,4>::aligned)  _mm_maskz_compress_epi32   (b, (__m128i) s.r); }
+inline simd<uint64_t,2>  compress_unsigned (const simd<uint64_t,2>  &s, uint64_t b) { return (simd<uint64_t,2>::aligned)  _mm_maskz_compress_epi64   (b, (__m128i) s.r); }
+inline simd<uint32_t,8>  compress_unsigned (const simd<uint32_t,8>  &s, uint64_t b) { return (simd<uint32_t,8>::aligned)  _mm256_maskz_compress_epi32(b, (__m256i) s.r); }
+inline simd<uint64_t,4>  compress_unsigned (const simd<uint64_t,4>  &s, uint64_t b) { return (simd<uint64_t,4>::aligned)  _mm256_maskz_compress_epi64(b, (__m256i) s.r); }
+inline simd<uint32_t,4>  expand_unsigned   (const simd<uint32_t,4>  &s, uint64_t b) { return (simd<uint32_t,4>::aligned)  _mm_maskz_expand_epi32     (b, (__m128i) s.r); }
+inline simd<uint64_t,2>  expand_unsigned   (const simd<uint64_t,2>  &s, uint64_t b) { return (simd<uint64_t,2>::aligned)  _mm_maskz_expand_epi64     (b, (__m128i) s.r); }
+inline simd<uint32_t,8>  expand_unsigned   (const simd<uint32_t,8>  &s, uint64_t b) { return (simd<uint32_t,8>::aligned)  _mm256_maskz_expand_epi32  (b, (__m256i) s.r); }
+inline simd<uint64_t,4>  expand_unsigned   (const simd<uint64_t,4>  &s, uint64_t b) { return (simd<uint64_t,4>::aligned)  _mm256_maskz_expand_epi64  (b, (__m256i) s.r); }
+
+template<> inline simd<uint32_t,4>  expand_load_unsigned<uint32_t,4>  (const uint32_t *p, uint64_t b) { return (simd<uint32_t,4>::aligned)  _mm_maskz_expandloadu_epi32   (b, p); }
+template<> inline simd<uint64_t,2>  expand_load_unsigned<uint64_t,2>  (const uint64_t *p, uint64_t b) { return (simd<uint64_t,2>::aligned)  _mm_maskz_expandloadu_epi64   (b, p); }
+template<> inline simd<uint32_t,8>  expand_load_unsigned<uint32_t,8>  (const uint32_t *p, uint64_t b) { return (simd<uint32_t,8>::aligned)  _mm256_maskz_expandloadu_epi32(b, p); }
+template<> inline simd<uint64_t,4>  expand_load_unsigned<uint64_t,4>  (const uint64_t *p, uint64_t b) { return (simd<uint64_t,4>::aligned)  _mm256_maskz_expandloadu_epi64(b, p); }
+#endif
+
+#if defined (__AVX512F__)
+inline simd<uint32_t,16> compress_unsigned (const simd<uint32_t,16> &s, uint64_t b) { return (simd<uint32_t,16>::aligned) _mm512_maskz_compress_epi32(b, (__m512i) s.r); }
+inline simd<uint64_t,8>  compress_unsigned (const simd<uint64_t,8>  &s, uint64_t b) { return (simd<uint64_t,8>::aligned)  _mm512_maskz_compress_epi64(b, (__m512i) s.r); }
+inline simd<uint32_t,16> expand_unsigned   (const simd<uint32_t,16> &s, uint64_t b) { return (simd<uint32_t,16>::aligned) _mm512_maskz_expand_epi32  (b, (__m512i) s.r); }
+inline simd<uint64_t,8>  expand_unsigned   (const simd<uint64_t,8>  &s, uint64_t b) { return (simd<uint64_t,8>::aligned)  _mm512_maskz_expand_epi64  (b, (__m512i) s.r); }
+
+template<> inline simd<uint32_t,16> expand_load_unsigned<uint32_t,16> (const uint32_t *p, uint64_t b) { return (simd<uint32_t,16>::aligned) _mm512_maskz_expandloadu_epi32(b, p); }
+template<> inline simd<uint64_t,8>  expand_load_unsigned<uint64_t,8>  (const uint64_t *p, uint64_t b) { return (simd<uint64_t,8>::aligned)  _mm512_maskz_expandloadu_epi64(b, p); }
+#endif
+
+template<class T, unsigned int N, class U = std::make_unsigned_t<typename simd<T,N>::int_type::type>>
+    inline simd<T,N> compress (const simd<T,N> &s, uint64_t b) { return reinterpret<T>(compress_unsigned(reinterpret<U>(s), b)); }
+
+template<class T, unsigned int N, class U = std::make_unsigned_t<typename simd<T,N>::int_type::type>>
+    inline simd<T,N> expand (const simd<T,N> &s, uint64_t b) { return reinterpret<T>(expand_unsigned(reinterpret<U>(s), b)); }
+
+template<class T, unsigned int N, class M> inline simd<T,N> compress (const simd<T,N> &s, const simd<M,N> &m) { return compress(s, bitmask(m)); }
+template<class T, unsigned int N, class M> inline simd<T,N> expand   (const simd<T,N> &s, const simd<M,N> &m) { return expand(s, bitmask(m)); }
+
+// Stream compaction, compress_store writes N elements to out (so there must be room for
+// them) and returns the number of selected lanes that are the valid ones. expand_load 
+// reads only the elements that go in the selected lanes.
+template<class T, unsigned int N>
+    inline unsigned int compress_store (T *out, const simd<T,N> &s, uint64_t b) { compress(s, b).storeu(out); return __builtin_popcountll(b); }
+
+template<unsigned int N, class T, class U = std::make_unsigned_t<typename simd<T,N>::int_type::type>>
+    inline simd<T,N> expand_load (const T *p, uint64_t b) { return reinterpret<T>(expand_load_unsigned<U,N>(reinterpret_cast<const U *>(p), b)); }
+
+template<class T, unsigned int N, class M> inline unsigned int compress_store (T *out, const simd<T,N> &s, const simd<M,N> &m) { return compress_store(out, s, bitmask(m)); }
+template<class T, unsigned int N, class M> inline simd<T,N>    expand_load    (const T *p, const simd<M,N> &m) { return expand_load<N>(p, bitmask(m)); }
+
+// Gather of p[index[i]] in each lane and scatter of the lanes to p[index[i]], when two lanes
+// of a scatter have the same index the last one is written. Natives use vpgatherdd and
+// vpgatherdq of AVX2 and vpscatterdd and vpscatterdq of AVX-512.
+template<class T, unsigned int N>
+    inline simd<T,N> gather_unsigned (const T *p, const simd<int32_t,N> &index)
+    {
+        T r[N];
+
+        for (unsigned int i = 0; i < N; i++)
+            r[i] = p[index[i]];
+
+        return simd<T,N>::loadu(r);
+    }
+
+template<class T, unsigned int N>
+    inline void scatter_unsigned (T *p, const simd<int32_t,N> &index, const simd<T,N> &s)
+    {
+        for (unsigned int i = 0; i < N; i++)
+            p[index[i]] = s[i];
+    }
+
+#if defined (__AVX2__)
+inline simd<uint32_t,4>  gather_unsigned (const uint32_t *p, const simd<int32_t,4>  &index) { return (simd<uint32_t,4>::aligned)  _mm_i32gather_epi32   ((const int *) p, (__m128i) index.r, 4); }
+inline simd<uint32_t,8>  gather_unsigned (const uint32_t *p, const simd<int32_t,8>  &index) { return (simd<uint32_t,8>::aligned)  _mm256_i32gather_epi32((const int *) p, (__m256i) index.r, 4); }
+inline simd<uint64_t,4>  gather_unsigned (const uint64_t *p, const simd<int32_t,4>  &index) { return (simd<uint64_t,4>::aligned)  _mm256_i32gather_epi64((const long long *) p, (__m128i) index.r, 8); }
+#endif
+
+#if defined (__AVX512VL__)
+inline void scatter_unsigned (uint32_t *p, const simd<int32_t,4>  &index, const simd<uint32_t,4>  &s) { _mm_i32scatter_epi32   (p, (__m128i) index.r, (__m128i) s.r, 4); }
+inline void scatter_unsigned (uint32_t *p, const simd<int32_t,8>  &index, const simd<uint32_t,8>  &s) { _mm256_i32scatter_epi32(p, (__m256i) index.r, (__m256i) s.r, 4); }
+inline void scatter_unsigned (uint64_t *p, const simd<int32_t,4>  &index, const simd<uint64_t,4>  &s) { _mm256_i32scatter_epi64(p, (__m128i) index.r, (__m256i) s.r, 8); }
+#endif
+
+#if defined (__AVX512F__)
+inline simd<uint32_t,16> gather_unsigned (const uint32_t *p, const simd<int32_t,16> &index) { return (simd<uint32_t,16>::aligned) _mm512_i32gather_epi32((__m512i) index.r, p, 4); }
+inline simd<uint64_t,8>  gather_unsigned (const uint64_t *p, const simd<int32_t,8>  &index) { return (simd<uint64_t,8>::aligned)  _mm512_i32gather_epi64((__m256i) index.r, p, 8); }
+inline void scatter_unsigned (uint32_t *p, const simd<int32_t,16> &index, const simd<uint32_t,16> &s) { _mm512_i32scatter_epi32(p, (__m512i) index.r, (__m512i) s.r, 4); }
+inline void scatter_unsigned (uint64_t *p, const simd<int32_t,8>  &index, const simd<uint64_t,8>  &s) { _mm512_i32scatter_epi64(p, (__m256i) index.r, (__m512i) s.r, 8); }
+#endif
+
+// Whether the scatter of N elements of type T is a single instruction, the generic one
+// stores the lanes one at a time and is slower than a scalar loop
+template<class T, unsigned int N>
+    constexpr bool simd_native_scatter =
+#if defined (__AVX512VL__)
+        (sizeof(T) == 4 && (N == 4 || N == 8 || N == 16)) || (sizeof(T) == 8 && (N == 4 || N == 8));
+#elif defined (__AVX512F__)
+        (sizeof(T) == 4 && N == 16) || (sizeof(T) == 8 && N == 8);
+#else
+        false;
+#endif
+
+template<class T, unsigned int N, class U = std::make_unsigned_t<typename simd<T,N>::int_type::type>>
+    inline simd<T,N> gather (const T *p, const simd<int32_t,N> &index) { return reinterpret<T>(gather_unsigned(reinterpret_cast<const U *>(p), index)); }
+
+template<class T, unsigned int N, class U = std::make_unsigned_t<typename simd<T,N>::int_type::type>>
+    inline void scatter (T *p, const simd<int32_t,N> &index, const simd<T,N> &s) { scatter_unsigned(reinterpret_cast<U *>(p), index, reinterpret<U>(s)); }
+
+#endif
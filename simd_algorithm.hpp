@@ -0,0 +1,369 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+*/
+
+#ifndef _simd_algorithm_hpp_
+#define _simd_algorithm_hpp_
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include "simd.hpp"
+
+// Algorithms over arrays that process N elements at a time with simd<T,N> objects.
+// Unaligned arrays are supported, the last elements are processed with partial loads.
+
+// Number of objects of B bytes processed by each iteration of the unrolled loops,
+// a whole cache line of 64 bytes
+constexpr unsigned int simd_unroll (unsigned int B) { return B < 64 ? 64 / B : 1; }
+
+// Transformation of n elements of the arrays in... as std::transform. The function is
+// called with a simd<T,N> for each array and its result is stored in out converted to
+// simd<R,N>. The last n % N elements are passed in partial objects with the lanes
+// after the end set to the last element, so that f sees only values of the arrays (no
+// integer division by zero). U is the unroll factor, zero selects it automatically.
+template<unsigned int N, unsigned int U = 0, class R, class F, class... T>
+    inline R * simd_transform_n (R *out, size_t n, F f, const T *...in)
+    {
+        constexpr unsigned int K = U ? U : simd_unroll(N * sizeof(R));
+
+        size_t i = 0;
+
+        for (; i + K * N <= n; i += K * N)
+            for (unsigned int k = 0; k < K; k++)
+                simd<R,N>(f(simd<T,N>::loadu(in + i + k * N)...)).storeu(out + i + k * N);
+
+        for (; i + N <= n; i += N)
+            simd<R,N>(f(simd<T,N>::loadu(in + i)...)).storeu(out + i);
+
+        if (i < n)
+            simd<R,N>(f(simd<T,N>::loadu(in + i, n - i, in[n - 1])...)).storeu(out + i, n - i);
+
+        return out + n;
+    }
+
+// Unary and binary versions with the arguments of std::transform
+template<unsigned int N, unsigned int U = 0, class T, class R, class F>
+    inline R * simd_transform (const T *first, const T *last, R *out, F f)
+        { return simd_transform_n<N,U>(out, last - first, f, first); }
+
+template<unsigned int N, unsigned int U = 0, class T, class V, class R, class F>
+    inline R * simd_transform (const T *first1, const T *last1, const V *first2, R *out, F f)
+        { return simd_transform_n<N,U>(out, last1 - first1, f, first1, first2); }
+
+// Reduction by op of the results of f on n elements of the arrays in..., as
+// std::transform_reduce. K independent accumulators hide the latency of op, they are
+// merged in a tree and then their lanes with reduce_lanes. The lanes of the last partial
+// object after the end are the last element for f and are masked out of op, so op needs
+// no identity element. Both functions take and return simd<R,N> objects, op must be
+// associative and commutative.
+template<unsigned int N, unsigned int K = 8, class R, class F, class G, class... T>
+    inline R simd_transform_reduce_n (size_t n, R init, F op, G f, const T *...in)
+    {
+        static_assert(K > 0 && (K & (K - 1)) == 0, "accumulators not a power of two");
+
+        typedef simd<R,N> A;
+        typedef typename A::int_type::type I;
+
+        if (n == 0)
+            return init;
+
+        // Few elements reduced one at a time
+        if (n < N)
+        {
+            A v = f(simd<T,N>::loadu(in, n, in[n - 1])...);
+
+            for (unsigned int j = 0; j < n; j++)
+                init = A(op(A(init), A(v[j])))[0];
+
+            return init;
+        }
+
+        A acc[K];
+
+        // Number of accumulators used
+        unsigned int m = n >= K * N ? K : 1;
+
+        for (unsigned int k = 0; k < m; k++)
+            acc[k] = f(simd<T,N>::loadu(in + k * N)...);
+
+        size_t i = m * N;
+
+        for (; i + K * N <= n; i += K * N)
+            for (unsigned int k = 0; k < K; k++)
+                acc[k] = op(acc[k], A(f(simd<T,N>::loadu(in + i + k * N)...)));
+
+        for (; i + N <= n; i += N)
+            acc[0] = op(acc[0], A(f(simd<T,N>::loadu(in + i)...)));
+
+        if (i < n)
+            acc[0] = blend(lane_index<I,N>() < I(n - i), A(op(acc[0], A(f(simd<T,N>::loadu(in + i, n - i, in[n - 1])...)))), acc[0]);
+
+        for (unsigned int s = m / 2; s > 0; s /= 2)
+            for (unsigned int k = 0; k < s; k++)
+                acc[k] = op(acc[k], acc[k + s]);
+
+        return A(op(A(init), reduce_lanes(acc[0], op)))[0];
+    }
+
+// Versions with the arguments of std::reduce and std::transform_reduce
+template<unsigned int N, unsigned int K = 8, class T, class R, class F>
+    inline R simd_reduce (const T *first, const T *last, R init, F op)
+        { return simd_transform_reduce_n<N,K>(last - first, init, op, [](const simd<T,N> &s) { return s; }, first); }
+
+template<unsigned int N, unsigned int K = 8, class T, class R, class F, class G>
+    inline R simd_transform_reduce (const T *first, const T *last, R init, F reduce, G transform)
+        { return simd_transform_reduce_n<N,K>(last - first, init, reduce, transform, first); }
+
+template<unsigned int N, unsigned int K = 8, class T, class V, class R, class F, class G>
+    inline R simd_transform_reduce (const T *first1, const T *last1, const V *first2, R init, F reduce, G transform)
+        { return simd_transform_reduce_n<N,K>(last1 - first1, init, reduce, transform, first1, first2); }
+
+// Compensated sum of the elements in [first, last) and dot product of two arrays (Sum2 and
+// Dot2 of Ogita, Rump and Oishi). Each lane of K accumulators keeps its own error term and
+// the results are as accurate as if computed with twice the precision of T.
+template<unsigned int N, unsigned int K = 4, class T>
+    inline T sum_compensated (const T *first, const T *last)
+    {
+        typedef simd<T,N> A;
+
+        A s[K], c[K];
+
+        for (unsigned int k = 0; k < K; k++)
+            s[k] = c[k] = T(0);
+
+        size_t n = last - first, i = 0;
+
+        for (; i + K * N <= n; i += K * N)
+            for (unsigned int k = 0; k < K; k++)
+            {
+                std::pair<A,A> t = two_sum(s[k], A::loadu(first + i + k * N));
+
+                s[k] = t.first;
+                c[k] = c[k] + t.second;
+            }
+
+        for (; i < n; i += N)
+        {
+            std::pair<A,A> t = two_sum(s[0], i + N <= n ? A::loadu(first + i) : A::loadu(first + i, n - i));
+
+            s[0] = t.first;
+            c[0] = c[0] + t.second;
+        }
+
+        for (unsigned int k = 1; k < K; k++)
+        {
+            std::pair<A,A> t = two_sum(s[0], s[k]);
+
+            s[0] = t.first;
+            c[0] = c[0] + (t.second + c[k]);
+        }
+
+        return sum_compensated(s[0], c[0]);
+    }
+
+template<unsigned int N, unsigned int K = 4, class T>
+    inline T dot2 (const T *first1, const T *last1, const T *first2)
+    {
+        typedef simd<T,N> A;
+
+        A s[K], c[K];
+
+        for (unsigned int k = 0; k < K; k++)
+            s[k] = c[k] = T(0);
+
+        size_t n = last1 - first1, i = 0;
+
+        for (; i + K * N <= n; i += K * N)
+            for (unsigned int k = 0; k < K; k++)
+            {
+                std::pair<A,A> p = two_prod(A::loadu(first1 + i + k * N), A::loadu(first2 + i + k * N));
+                std::pair<A,A> t = two_sum(s[k], p.first);
+
+                s[k] = t.first;
+                c[k] = c[k] + (p.second + t.second);
+            }
+
+        for (; i < n; i += N)
+        {
+            std::pair<A,A> p = i + N <= n ? two_prod(A::loadu(first1 + i), A::loadu(first2 + i)) : two_prod(A::loadu(first1 + i, n - i), A::loadu(first2 + i, n - i));
+            std::pair<A,A> t = two_sum(s[0], p.first);
+
+            s[0] = t.first;
+            c[0] = c[0] + (p.second + t.second);
+        }
+
+        for (unsigned int k = 1; k < K; k++)
+        {
+            std::pair<A,A> t = two_sum(s[0], s[k]);
+
+            s[0] = t.first;
+            c[0] = c[0] + (t.second + c[k]);
+        }
+
+        return sum_compensated(s[0], c[0]);
+    }
+
+// Searches as std::find_if and std::count_if with a predicate that takes a simd<T,N> and
+// returns a mask. The masks of K objects are merged before the test of bitmask, so that
+// the loop exits at the first match with a single branch every K * N elements. The lanes
+// of the last partial object after the end are the last element and their bits are cleared.
+template<unsigned int N, unsigned int K = 0, class T, class P>
+    inline const T * simd_find_if (const T *first, const T *last, P pred)
+    {
+        constexpr unsigned int U = K ? K : simd_unroll(N * sizeof(T));
+
+        typedef decltype(pred(simd<T,N>())) M;
+
+        size_t n = last - first, i = 0;
+
+        for (; i + U * N <= n; i += U * N)
+        {
+            M m[U], a = m[0] = pred(simd<T,N>::loadu(first + i));
+
+            for (unsigned int k = 1; k < U; k++)
+                a = a | (m[k] = pred(simd<T,N>::loadu(first + i + k * N)));
+
+            if (bitmask(a))
+                for (unsigned int k = 0; k < U; k++)
+                    if (uint64_t b = bitmask(m[k]))
+                        return first + i + k * N + __builtin_ctzll(b);
+        }
+
+        for (; i + N <= n; i += N)
+            if (uint64_t b = bitmask(pred(simd<T,N>::loadu(first + i))))
+                return first + i + __builtin_ctzll(b);
+
+        if (i < n)
+            if (uint64_t b = bitmask(pred(simd<T,N>::loadu(first + i, n - i, first[n - 1]))) & ((uint64_t(1) << (n - i)) - 1))
+                return first + i + __builtin_ctzll(b);
+
+        return last;
+    }
+
+template<unsigned int N, class T, class P>
+    inline size_t simd_count_if (const T *first, const T *last, P pred)
+    {
+        size_t n = last - first, i = 0, c = 0;
+
+        for (; i + N <= n; i += N)
+            c += __builtin_popcountll(bitmask(pred(simd<T,N>::loadu(first + i))));
+
+        if (i < n)
+            c += __builtin_popcountll(bitmask(pred(simd<T,N>::loadu(first + i, n - i, first[n - 1]))) & ((uint64_t(1) << (n - i)) - 1));
+
+        return c;
+    }
+
+template<unsigned int N, unsigned int K = 0, class T>
+    inline const T * simd_find (const T *first, const T *last, T value)
+        { return simd_find_if<N,K>(first, last, [value](const simd<T,N> &s) { return s == value; }); }
+
+template<unsigned int N, class T>
+    inline size_t simd_count (const T *first, const T *last, T value)
+        { return simd_count_if<N>(first, last, [value](const simd<T,N> &s) { return s == value; }); }
+
+template<unsigned int N, unsigned int K = 0, class T>
+    inline bool simd_contains (const T *first, const T *last, T value)
+        { return simd_find<N,K>(first, last, value) != last; }
+
+// Histogram of n elements, counts[b] is the number of elements that binner puts in the
+// bin b < bins. The binner takes a simd<T,N> and returns the bins of its lanes as integers,
+// the lanes after the end of the last partial object are the last element.
+// The bins of a block of elements are computed first, then the increments go in turn to
+// four copies of the histogram, so that runs of elements with the same bin do not wait for
+// each other. The copies are summed N bins at a time at the end.
+template<unsigned int N, class C, class T, class F>
+    inline void simd_histogram (C *counts, size_t bins, const T *data, size_t n, F binner)
+    {
+        // Elements in a block, a small one keeps the bins in the cache with no stall on
+        // the stores just done
+        constexpr unsigned int M = N < 64 ? 64 : N;
+
+        std::vector<C> h(4 * bins, C(0));
+
+        C *h0 = &h[0], *h1 = h0 + bins, *h2 = h1 + bins, *h3 = h2 + bins;
+
+        typedef decltype(binner(simd<T,N>())) B;
+        typename B::type b[M];
+
+        for (size_t i = 0; i < n; i += M)
+        {
+            unsigned int m = i + M <= n ? M : n - i;
+
+            for (unsigned int j = 0; j < m; j += N)
+                if (j + N <= m)
+                    B(binner(simd<T,N>::loadu(data + i + j))).storeu(b + j);
+                else
+                    B(binner(simd<T,N>::loadu(data + i + j, m - j, data[i + m - 1]))).storeu(b + j, m - j);
+
+            unsigned int j = 0;
+
+            for (; j + 4 <= m; j += 4)
+            {
+                h0[b[j]]++;
+                h1[b[j + 1]]++;
+                h2[b[j + 2]]++;
+                h3[b[j + 3]]++;
+            }
+
+            for (; j < m; j++)
+                h0[b[j]]++;
+        }
+
+        for (size_t k = 0; k < bins; k += N)
+        {
+            unsigned int m = k + N <= bins ? N : bins - k;
+
+            simd<C,N> r = simd<C,N>::loadu(&h[k], m);
+
+            for (unsigned int c = 1; c < 4; c++)
+                r += simd<C,N>::loadu(&h[c * bins + k], m);
+
+            r.storeu(counts + k, m);
+        }
+    }
+
+// Binners of simd_histogram. Uniform bins of width (hi - lo) / bins, the values out of
+// [lo, hi) and NaN go in the first or in the last bin. Digits of radix B = 2^bits of
+// unsigned integers, the one of weight B^d.
+template<class T>
+    inline auto simd_bin_uniform (T lo, T hi, unsigned int bins)
+    {
+        T scale = bins / (hi - lo);
+
+        return [lo, scale, bins](const auto &x)
+        {
+            typedef std::decay_t<decltype(x)> S;
+            return typename S::int_type(std::min(std::max((x - lo) * scale, S(0)), S(T(bins - 1))));
+        };
+    }
+
+inline auto simd_bin_digit (unsigned int d, unsigned int bits = 8)
+{
+    return [d, bits](const auto &x) { return (x >> (d * bits)) & ((1u << bits) - 1); };
+}
+
+#endif
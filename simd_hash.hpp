@@ -0,0 +1,254 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+*/
+
+#ifndef _simd_hash_hpp_
+#define _simd_hash_hpp_
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include "simd.hpp"
+
+// Mixing of the bits of a hash value (the finalizer of MurmurHash3), for a uint64_t or for
+// N of them in a simd<uint64_t,N>. The identity hash of integers is turned into one where
+// every bit depends on all the bits of the key.
+template<class T>
+    inline T hash_mix (T h)
+    {
+        h = (h ^ (h >> 33)) * uint64_t(0xff51afd7ed558ccd);
+        h = (h ^ (h >> 33)) * uint64_t(0xc4ceb9fe1a85ec53);
+        return h ^ (h >> 33);
+    }
+
+// Open addressing hash map with the slots in groups of G. Each slot has a control byte that
+// is empty, deleted or the 7 lowest bits of the hash of its key, so that a whole group is
+// probed by comparing G control bytes with a simd<uint8_t,G> and the keys are compared only
+// in the slots that match. The other bits of the hash select the first group, the next
+// ones are probed in triangular order until a group with an empty slot. Erased slots become
+// tombstones when their group is full, because probes may have passed through it. The key
+// and the value of a slot are stored together, so that they are in the same cache line.
+template<class K, class V, class H = std::hash<K>, unsigned int G = 16>
+    class simd_hash_map
+    {
+    public:
+        // Number of slots in a group
+        static constexpr unsigned int group_size = G;
+
+        // Control bytes of the slots without a key
+        static constexpr uint8_t empty   = 0x80;
+        static constexpr uint8_t deleted = 0xFE;
+
+        simd_hash_map (size_t n = 0) { reserve(n); }
+
+        // Number of keys and of slots
+        size_t size     () const { return count; }
+        size_t capacity () const { return control.size(); }
+
+        // Rehash so that n keys fit with a load factor of at most 7/8
+        void reserve (size_t n)
+        {
+            size_t groups = 1;
+
+            while (groups * G * 7 / 8 < n)
+                groups *= 2;
+
+            if (groups * G > capacity())
+                rehash(groups);
+        }
+
+        // Value of key or nullptr if it is not in the map
+        V * find (const K &key)
+        {
+            size_t i = slot(key, hash_mix(uint64_t(H()(key))));
+            return i < capacity() ? &slots[i].second : nullptr;
+        }
+
+        const V * find (const K &key) const { return const_cast<simd_hash_map *>(this)->find(key); }
+
+        bool contains (const K &key) const { return find(key) != nullptr; }
+
+        // Insertion of key with value if key is not in the map, returns the value of key and
+        // whether it has been inserted
+        std::pair<V *, bool> insert (const K &key, const V &value)
+        {
+            uint64_t h = hash_mix(uint64_t(H()(key)));
+            size_t i = slot(key, h);
+
+            if (i < capacity())
+                return {&slots[i].second, false};
+
+            // When the keys and the tombstones would exceed 7/8 of the slots the capacity is
+            // doubled if the keys are at least 7/16 of them (half the maximum load), otherwise
+            // the tombstones are cleared by a rehash at the same capacity
+            if ((count + tombstones + 1) * 8 > capacity() * 7)
+                rehash(count * 16 < capacity() * 7 ? capacity() / G : capacity() ? 2 * capacity() / G : 1);
+
+            i = free_slot(h);
+
+            tombstones -= control[i] == deleted;
+            count++;
+
+            control[i] = h & 0x7F;
+            slots[i].first = key;
+            slots[i].second = value;
+
+            return {&slots[i].second, true};
+        }
+
+        // Value of key, inserted with the default value if it is not in the map
+        V & operator [] (const K &key) { return *insert(key, V()).first; }
+
+        // Removal of key, returns whether it was in the map
+        bool erase (const K &key)
+        {
+            size_t i = slot(key, hash_mix(uint64_t(H()(key))));
+
+            if (i >= capacity())
+                return false;
+
+            bool free = bitmask(simd<uint8_t,G>::loadu(&control[i / G * G]) == empty);
+
+            control[i] = free ? empty : deleted;
+            tombstones += !free;
+            count--;
+
+            return true;
+        }
+
+        // Lookup of n keys, found[i] tells whether query[i] is in the map and in that case its
+        // value is copied in out[i]. The keys are processed in blocks, first their hashes are
+        // mixed N at a time and the control bytes of their first groups are prefetched, then
+        // they are resolved. A found key costs a miss on its control bytes and one on its slot,
+        // that has both the key and the value. The out-of-order core already overlaps the misses
+        // of independent calls of find, so this is only a few percent faster than a loop of them.
+        void find_batch (const K *query, size_t n, V *out, bool *found) const
+        {
+            constexpr unsigned int N = simd_native_size<uint64_t>;
+            constexpr unsigned int B = 64;
+
+            uint64_t h[B];
+            size_t mask = control.size() / G - 1;
+
+            for (size_t i = 0; i < n; i += B)
+            {
+                unsigned int m = i + B <= n ? B : n - i;
+
+                for (unsigned int j = 0; j < m; j++)
+                    h[j] = uint64_t(H()(query[i + j]));
+
+                for (unsigned int j = 0; j < m; j += N)
+                    if (j + N <= m)
+                        hash_mix(simd<uint64_t,N>::loadu(h + j)).storeu(h + j);
+                    else
+                        hash_mix(simd<uint64_t,N>::loadu(h + j, m - j)).storeu(h + j, m - j);
+
+                if (!control.empty())
+                    for (unsigned int j = 0; j < m; j++)
+                        __builtin_prefetch(&control[((h[j] >> 7) & mask) * G]);
+
+                for (unsigned int j = 0; j < m; j++)
+                {
+                    size_t k = slot(query[i + j], h[j]);
+
+                    found[i + j] = k < capacity();
+
+                    if (found[i + j])
+                        out[i + j] = slots[k].second;
+                }
+            }
+        }
+
+        void clear ()
+        {
+            std::fill(control.begin(), control.end(), empty);
+            count = tombstones = 0;
+        }
+
+    private:
+        std::vector<uint8_t> control;
+        std::vector<std::pair<K,V>> slots;
+
+        size_t count = 0, tombstones = 0;
+
+        // Slot of key with hash h, or capacity() if it is not in the map
+        size_t slot (const K &key, uint64_t h) const
+        {
+            if (control.empty())
+                return 0;
+
+            size_t mask = control.size() / G - 1;
+
+            for (size_t g = (h >> 7) & mask, step = 1; ; g = (g + step++) & mask)
+            {
+                simd<uint8_t,G> c = simd<uint8_t,G>::loadu(&control[g * G]);
+
+                for (uint64_t b = bitmask(c == uint8_t(h & 0x7F)); b; b &= b - 1)
+                    if (slots[g * G + __builtin_ctzll(b)].first == key)
+                        return g * G + __builtin_ctzll(b);
+
+                if (bitmask(c == empty))
+                    return control.size();
+            }
+        }
+
+        // First empty or deleted slot in the probe sequence of hash h
+        size_t free_slot (uint64_t h) const
+        {
+            size_t mask = control.size() / G - 1;
+
+            for (size_t g = (h >> 7) & mask, step = 1; ; g = (g + step++) & mask)
+                if (uint64_t b = bitmask(simd<uint8_t,G>::loadu(&control[g * G]) >= empty))
+                    return g * G + __builtin_ctzll(b);
+        }
+
+        // Reinsertion of all the keys in a number of groups that is a power of two
+        void rehash (size_t groups)
+        {
+            std::vector<uint8_t> c(groups * G, empty);
+            std::vector<std::pair<K,V>> k(groups * G);
+
+            control.swap(c);
+            slots.swap(k);
+            tombstones = 0;
+
+            for (size_t i = 0; i < c.size(); i++)
+                if (c[i] < empty)
+                {
+                    size_t j = free_slot(hash_mix(uint64_t(H()(k[i].first))));
+
+                    control[j] = c[i];
+                    slots[j] = std::move(k[i]);
+                }
+        }
+    };
+
+template<class K, class V, class H, unsigned int G> constexpr unsigned int simd_hash_map<K,V,H,G>::group_size;
+template<class K, class V, class H, unsigned int G> constexpr uint8_t simd_hash_map<K,V,H,G>::empty;
+template<class K, class V, class H, unsigned int G> constexpr uint8_t simd_hash_map<K,V,H,G>::deleted;
+
+#endif
@@ -0,0 +1,242 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+*/
+
+#ifndef _simd_scan_hpp_
+#define _simd_scan_hpp_
+#include <cassert>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include "simd_algorithm.hpp"
+
+// Scans of columns stored as arrays. A predicate takes a simd<T,N> for each column and
+// returns a mask, e.g. [](auto a, auto b, auto c) { return (a > 3) & (b < c); }. The rows
+// that satisfy it are given as a bitmap, where bit i % 64 of word i / 64 is the row i,
+// or as a selection vector with their indexes in ascending order. The rows after the end
+// of the last partial objects repeat the last row, so that the predicate sees only values
+// of the columns, and are dropped from the result.
+
+// Bitmap of the n rows, made of (n + 63) / 64 words with the bits after the end cleared
+template<unsigned int N, class P, class... T>
+    inline void simd_scan_bitmap (uint64_t *bitmap, size_t n, P pred, const T *...columns)
+    {
+        static_assert(64 % N == 0, "N must divide 64");
+
+        for (size_t i = 0; i < n; i += 64)
+        {
+            uint64_t w = 0;
+
+            if (i + 64 <= n)
+                for (unsigned int j = 0; j < 64; j += N)
+                    w |= bitmask(pred(simd<T,N>::loadu(columns + i + j)...)) << j;
+            else
+            {
+                for (unsigned int j = 0; i + j < n; j += N)
+                    w |= bitmask(pred(simd<T,N>::loadu(columns + i + j, n - i - j, columns[n - 1])...)) << j;
+
+                w &= (uint64_t(1) << (n - i)) - 1;
+            }
+
+            bitmap[i / 64] = w;
+        }
+    }
+
+// Selection vector of the n rows, returns its length. The rows are compressed N at a time
+// and there must be room for n indexes.
+template<unsigned int N, class P, class... T>
+    inline size_t simd_scan_select (uint32_t *selection, size_t n, P pred, const T *...columns)
+    {
+        size_t c = 0, i = 0;
+
+        for (; i + N <= n; i += N)
+            c += compress_store(selection + c, lane_index<uint32_t,N>() + uint32_t(i), bitmask(pred(simd<T,N>::loadu(columns + i)...)));
+
+        if (i < n)
+            for (uint64_t b = bitmask(pred(simd<T,N>::loadu(columns + i, n - i, columns[n - 1])...)) & ((uint64_t(1) << (n - i)) - 1); b; b &= b - 1)
+                selection[c++] = uint32_t(i + __builtin_ctzll(b));
+
+        return c;
+    }
+
+// Combinations of bitmaps of the same rows, out can be one of the inputs
+inline void bitmap_and (uint64_t *out, const uint64_t *a, const uint64_t *b, size_t words)
+    { simd_transform_n<simd_native_size<uint64_t>>(out, words, [](const auto &x, const auto &y) { return x & y; }, a, b); }
+
+inline void bitmap_or (uint64_t *out, const uint64_t *a, const uint64_t *b, size_t words)
+    { simd_transform_n<simd_native_size<uint64_t>>(out, words, [](const auto &x, const auto &y) { return x | y; }, a, b); }
+
+inline void bitmap_andnot (uint64_t *out, const uint64_t *a, const uint64_t *b, size_t words)
+    { simd_transform_n<simd_native_size<uint64_t>>(out, words, [](const auto &x, const auto &y) { return x & ~y; }, a, b); }
+
+// Number of rows set in a bitmap
+inline size_t bitmap_count (const uint64_t *bitmap, size_t words)
+{
+    size_t c = 0;
+
+    for (size_t i = 0; i < words; i++)
+        c += __builtin_popcountll(bitmap[i]);
+
+    return c;
+}
+
+// Selection vector of the rows set in a bitmap of n rows, returns its length. The words
+// are compressed in parts of N bits, there must be room for n indexes.
+inline size_t bitmap_select (uint32_t *selection, const uint64_t *bitmap, size_t n)
+{
+    constexpr unsigned int N = simd_native_size<uint32_t>;
+
+    size_t c = 0;
+
+    for (size_t i = 0; i < n; i += 64)
+    {
+        uint64_t b = bitmap[i / 64];
+
+        if (i + 64 <= n && b)
+            for (unsigned int j = 0; j < 64; j += N)
+                c += compress_store(selection + c, lane_index<uint32_t,N>() + uint32_t(i + j), b >> j & ((uint64_t(1) << N) - 1));
+        else
+            for (b &= n - i < 64 ? (uint64_t(1) << (n - i)) - 1 : ~uint64_t(0); b; b &= b - 1)
+                selection[c++] = uint32_t(i + __builtin_ctzll(b));
+    }
+
+    return c;
+}
+
+// Keys converted to int32_t with the native widenings, GCC splits the direct conversion of
+// 8-bit lanes into single elements
+template<unsigned int N> inline simd<int32_t,N> simd_group_key (const simd<uint8_t,N>  &k) { return reinterpret<int32_t>(widen(widen(k))); }
+template<unsigned int N> inline simd<int32_t,N> simd_group_key (const simd<uint16_t,N> &k) { return reinterpret<int32_t>(widen(k)); }
+
+// Updates of the tables of simd_group_reduce N rows at a time, returns the number of rows
+// done. The N rows of an object never update the same element, so they are gathered,
+// combined by op and scattered at once with no conflict. Consecutive objects go to the
+// two sets of tables in turn, a gather of the elements just scattered would wait for the
+// scatter to complete. None without a native scatter of whole registers, the scalar loop
+// is faster.
+template<unsigned int N, class A, class K, class T, class F>
+    inline size_t simd_group_update (A *tables, size_t groups, const K *keys, const T *values, size_t n, F op, std::true_type)
+    {
+        typedef simd<A,N> S;
+        typedef simd<int32_t,N> I;
+
+        A *other = tables + groups * N;
+
+        size_t i = 0;
+
+        for (; i + 2 * N <= n; i += 2 * N)
+        {
+            I k0 = simd_group_key(simd<K,N>::loadu(keys + i));
+            I k1 = simd_group_key(simd<K,N>::loadu(keys + i + N));
+
+            assert(bitmask((k0 >= int32_t(groups)) | (k1 >= int32_t(groups))) == 0);
+
+            I index0 = k0 * int32_t(N) + lane_index<int32_t,N>();
+            I index1 = k1 * int32_t(N) + lane_index<int32_t,N>();
+
+            scatter(tables, index0, S(op(gather(tables, index0), S(simd<T,N>::loadu(values + i)))));
+            scatter(other,  index1, S(op(gather(other,  index1), S(simd<T,N>::loadu(values + i + N)))));
+        }
+
+        return i;
+    }
+
+template<unsigned int N, class A, class K, class T, class F>
+    inline size_t simd_group_update (A *, size_t, const K *, const T *, size_t, F, std::false_type) { return 0; }
+
+// Aggregation of the values grouped by a small key, out[g] is the reduction by op of init
+// and of the values of the rows with keys[i] == g, for each g < groups. All the keys must be
+// smaller than groups. Each group has two tables with an element for each lane, so that
+// consecutive rows with the same key update different elements and do not wait for each
+// other. With a native scatter of N elements of A in a 64-byte register (AVX-512) the rows
+// are processed N at a time by simd_group_update, otherwise they are scalar and go to
+// the first four lanes in turn. The tables are merged by reduce_lanes at the end, N must
+// be a power of two. init must be the identity of merge, op and merge take two A or two
+// simd<A,N> objects.
+template<unsigned int N, class A, class K, class T, class F, class G>
+    inline void simd_group_reduce (A *out, size_t groups, const K *keys, const T *values, size_t n, A init, F op, G merge)
+    {
+        static_assert(std::is_unsigned<K>::value && sizeof(K) <= 2, "keys must be uint8_t or uint16_t");
+
+        typedef simd<A,N> S;
+
+        std::vector<A> tables(2 * groups * N, init);
+
+        size_t i = simd_group_update<N>(tables.data(), groups, keys, values, n, op, std::integral_constant<bool, simd_native_scatter<A,N> && sizeof(S) == 64>());
+
+        // Scalar updates, of the first four lanes in turn
+        A *t0 = &tables[0], *t1 = t0 + 1 % N, *t2 = t0 + 2 % N, *t3 = t0 + 3 % N;
+
+        for (; i + 4 <= n; i += 4)
+        {
+            assert(keys[i] < groups && keys[i + 1] < groups && keys[i + 2] < groups && keys[i + 3] < groups);
+
+            t0[keys[i]     * N] = op(t0[keys[i]     * N], A(values[i]));
+            t1[keys[i + 1] * N] = op(t1[keys[i + 1] * N], A(values[i + 1]));
+            t2[keys[i + 2] * N] = op(t2[keys[i + 2] * N], A(values[i + 2]));
+            t3[keys[i + 3] * N] = op(t3[keys[i + 3] * N], A(values[i + 3]));
+        }
+
+        for (; i < n; i++)
+        {
+            assert(keys[i] < groups);
+            t0[keys[i] * N] = op(t0[keys[i] * N], A(values[i]));
+        }
+
+        for (size_t g = 0; g < groups; g++)
+            out[g] = S(reduce_lanes(S(merge(S::loadu(&tables[g * N]), S::loadu(&tables[(groups + g) * N]))), merge))[0];
+    }
+
+// Sum, number, minimum and maximum of the values of each group. The groups without rows
+// have zero sum and count, the largest value as minimum and the smallest as maximum.
+template<unsigned int N, class A, class K, class T>
+    inline void simd_group_sum (A *sums, size_t groups, const K *keys, const T *values, size_t n)
+    {
+        auto add = [](const auto &a, const auto &b) { return a + b; };
+        simd_group_reduce<N>(sums, groups, keys, values, n, A(0), add, add);
+    }
+
+template<unsigned int N, class A, class K>
+    inline void simd_group_count (A *counts, size_t groups, const K *keys, size_t n)
+    {
+        simd_group_reduce<N>(counts, groups, keys, keys, n, A(0), [](const auto &a, const auto &) { return a + 1; }, [](const auto &a, const auto &b) { return a + b; });
+    }
+
+template<unsigned int N, class A, class K, class T>
+    inline void simd_group_min (A *mins, size_t groups, const K *keys, const T *values, size_t n)
+    {
+        auto op = [](const auto &a, const auto &b) { return std::min(a, b); };
+        simd_group_reduce<N>(mins, groups, keys, values, n, std::numeric_limits<A>::has_infinity ? std::numeric_limits<A>::infinity() : std::numeric_limits<A>::max(), op, op);
+    }
+
+template<unsigned int N, class A, class K, class T>
+    inline void simd_group_max (A *maxs, size_t groups, const K *keys, const T *values, size_t n)
+    {
+        auto op = [](const auto &a, const auto &b) { return std::max(a, b); };
+        simd_group_reduce<N>(maxs, groups, keys, values, n, std::numeric_limits<A>::has_infinity ? -std::numeric_limits<A>::infinity() : std::numeric_limits<A>::lowest(), op, op);
+    }
+
+#endif
@@ -0,0 +1,448 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <https://unlicense.org>
+*/
+
+#ifndef _simd_sort_hpp_
+#define _simd_sort_hpp_
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include "simd_algorithm.hpp"
+
+// Quicksort with vectorized partitioning. N elements at a time are compared with the pivot
+// and moved by partition_lanes, the smaller ones to the left end and the others to the right
+// end of the free space. Two objects are kept aside at the start so that there is always
+// room for a whole store on both sides. Keys can carry a payload of values of the same size.
+
+// Partition of [first, last) with the keys smaller than the pivot first, values follow
+// the keys when P is true. Returns the first key not smaller than the pivot.
+template<bool P, unsigned int N, class T, class V>
+    inline T * simd_sort_partition (T *first, T *last, V *values, T pivot)
+    {
+        typedef simd<T,N> A;
+        typedef simd<V,N> B;
+
+        T *lw = first, *rw = last, *lr = first + N, *rr = last - N;
+        V *values_end = values + (last - first);
+
+        // Objects kept aside to make room
+        A kl = A::loadu(first), kr = A::loadu(last - N);
+        B vl = P ? B::loadu(values) : B(), vr = P ? B::loadu(values_end - N) : B();
+
+        while (rr - lr >= N)
+        {
+            A k;
+            B v;
+
+            // Reading from the side with less free space leaves N free slots on both sides
+            if (lr - lw <= rw - rr)
+            {
+                k = A::loadu(lr);
+                if (P) v = B::loadu(values + (lr - first));
+                lr += N;
+            }
+            else
+            {
+                rr -= N;
+                k = A::loadu(rr);
+                if (P) v = B::loadu(values + (rr - first));
+            }
+
+            uint64_t b = bitmask(k < pivot);
+            unsigned int c = __builtin_popcountll(b);
+
+            A pk = partition_lanes(k, b);
+            pk.storeu(lw);
+            pk.storeu(rw - N);
+
+            if (P)
+            {
+                B pv = partition_lanes(v, b);
+                pv.storeu(values + (lw - first));
+                pv.storeu(values + (rw - N - first));
+            }
+
+            lw += c;
+            rw -= N - c;
+        }
+
+        // Remaining elements and the objects kept aside, one at a time
+        T k[3 * N];
+        V v[3 * N];
+        size_t n = rr - lr;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            k[i] = lr[i];
+            if (P) v[i] = values[lr - first + i];
+        }
+
+        kl.storeu(k + n);
+        kr.storeu(k + n + N);
+
+        if (P)
+        {
+            vl.storeu(v + n);
+            vr.storeu(v + n + N);
+        }
+
+        for (size_t i = 0; i < n + 2 * N; i++)
+        {
+            T *w = k[i] < pivot ? lw++ : --rw;
+
+            *w = k[i];
+            if (P) values[w - first] = v[i];
+        }
+
+        return lw;
+    }
+
+// Small ranges sorted by networks of up to 8 objects, the lanes after the end are filled
+// with the largest value
+template<unsigned int N, unsigned int K, class T>
+    inline void simd_sort_network (T *first, size_t n)
+    {
+        simd<T,N> rows[K];
+
+        T fill = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+
+        for (unsigned int k = 0; k < K; k++)
+            rows[k] = k * N + N <= n ? simd<T,N>::loadu(first + k * N) : simd<T,N>::loadu(first + k * N, k * N < n ? n - k * N : 0, fill);
+
+        sort(rows);
+
+        for (unsigned int k = 0; k < K && k * N < n; k++)
+            if (k * N + N <= n)
+                rows[k].storeu(first + k * N);
+            else
+                rows[k].storeu(first + k * N, n - k * N);
+    }
+
+template<unsigned int N, class T, class V>
+    inline void simd_sort_small (T *first, T *last, V *, std::false_type)
+    {
+        size_t n = last - first;
+
+        if (n <= 2 * N)
+            simd_sort_network<N,2>(first, n);
+        else if (n <= 4 * N)
+            simd_sort_network<N,4>(first, n);
+        else
+            simd_sort_network<N,8>(first, n);
+    }
+
+// Insertion sort with the payload
+template<unsigned int N, class T, class V>
+    inline void simd_sort_small (T *first, T *last, V *values, std::true_type)
+    {
+        for (T *i = first + 1; i < last; i++)
+        {
+            T k = *i;
+            V v = values[i - first];
+            T *j = i;
+
+            for (; j > first && k < j[-1]; j--)
+            {
+                *j = j[-1];
+                values[j - first] = values[j - first - 1];
+            }
+
+            *j = k;
+            values[j - first] = v;
+        }
+    }
+
+// Heapsort of n keys, used when the pivots are bad
+template<bool P, class T, class V>
+    inline void simd_sort_sift (T *keys, V *values, size_t i, size_t n)
+    {
+        T k = keys[i];
+        V v = values[i];
+
+        for (size_t j; (j = 2 * i + 1) < n; i = j)
+        {
+            if (j + 1 < n && keys[j] < keys[j + 1])
+                j++;
+
+            if (!(k < keys[j]))
+                break;
+
+            keys[i] = keys[j];
+            if (P) values[i] = values[j];
+        }
+
+        keys[i] = k;
+        if (P) values[i] = v;
+    }
+
+template<bool P, class T, class V>
+    inline void simd_sort_heap (T *keys, size_t n, V *values)
+    {
+        for (size_t i = n / 2; i-- > 0; )
+            simd_sort_sift<P>(keys, values, i, n);
+
+        for (size_t i = n; i-- > 1; )
+        {
+            std::swap(keys[0], keys[i]);
+            if (P) std::swap(values[0], values[i]);
+
+            simd_sort_sift<P>(keys, values, 0, i);
+        }
+    }
+
+template<bool P, unsigned int N, class T, class V>
+    inline void simd_sort_recursive (T *first, T *last, V *values, unsigned int depth)
+    {
+        // Ranges sorted by simd_sort_small, at least two objects are needed by the partition
+        const size_t small = P ? 4 * N : 8 * N;
+
+        while (size_t(last - first) > small)
+        {
+            // Too many bad pivots, heapsort as in introsort
+            if (depth-- == 0)
+                return simd_sort_heap<P>(first, last - first, values);
+
+            // Median of three
+            T a = first[0], b = first[(last - first) / 2], c = last[-1];
+            T pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+
+            T *middle = simd_sort_partition<P,N>(first, last, values, pivot);
+
+            // The pivot is the smallest key, the keys equal to it are moved in front and
+            // they are already sorted
+            if (middle == first)
+            {
+                T next = pivot;
+
+                for (T *i = first; i < last; i++)
+                    if (pivot < *i && (next == pivot || *i < next))
+                        next = *i;
+
+                if (next == pivot)
+                    return;
+
+                T *equal = simd_sort_partition<P,N>(first, last, values, next);
+
+                values += equal - first;
+                first = equal;
+                continue;
+            }
+
+            // Recursion on the smaller side
+            if (middle - first < last - middle)
+            {
+                simd_sort_recursive<P,N>(first, middle, values, depth);
+                values += middle - first;
+                first = middle;
+            }
+            else
+            {
+                simd_sort_recursive<P,N>(middle, last, values + (middle - first), depth);
+                last = middle;
+            }
+        }
+
+        simd_sort_small<N>(first, last, values, std::integral_constant<bool, P>());
+    }
+
+// Sorting of [first, last) in ascending order, for 32 and 64-bit integers and floating point
+// keys without NaN. The second version moves values[i] together with first[i].
+template<unsigned int N, class T>
+    inline void simd_sort (T *first, T *last)
+    {
+        static_assert(sizeof(T) == 4 || sizeof(T) == 8, "unsupported type");
+        simd_sort_recursive<false,N>(first, last, first, 2 * (64 - __builtin_clzll(uint64_t(last - first) | 1)));
+    }
+
+template<unsigned int N, class T, class V>
+    inline void simd_sort (T *first, T *last, V *values)
+    {
+        static_assert((sizeof(T) == 4 || sizeof(T) == 8) && sizeof(V) == sizeof(T), "unsupported type");
+        simd_sort_recursive<true,N>(first, last, values, 2 * (64 - __builtin_clzll(uint64_t(last - first) | 1)));
+    }
+
+template<class T>
+    inline void simd_sort (T *first, T *last) { simd_sort<simd_native_size<T>>(first, last); }
+
+template<class T, class V>
+    inline void simd_sort (T *first, T *last, V *values) { simd_sort<simd_native_size<T>>(first, last, values); }
+
+// LSD radix sort by bytes. The keys are mapped to unsigned integers with the same order,
+// then the histograms of all their bytes are computed by a single simd_histogram and each
+// byte that is not the same for all keys is sorted by a stable scatter. The scatter moves
+// one element at a time through software write-combining buffers, one for each bucket
+// written to memory by whole cache lines when full, so that 256 streams of single elements
+// do not thrash the cache and the TLB.
+
+// Keys mapped to unsigned integers with the same order and back, the sign bit of signed
+// integers is flipped and all the bits of negative floating point numbers.
+template<class T, unsigned int N, class U = std::make_unsigned_t<typename simd<T,N>::int_type::type>>
+    inline simd<U,N> radix_key (const simd<T,N> &s)
+    {
+        constexpr U h = U(std::is_signed<T>::value) << (8 * sizeof(U) - 1);
+
+        simd<U,N> u = reinterpret<U>(s);
+        simd<U,N> m = std::is_floating_point<T>::value ? simd<U,N>(U(0) - (u >> (8 * sizeof(U) - 1))) : simd<U,N>(U(0));
+
+        return u ^ (m | h);
+    }
+
+template<class T, unsigned int N, class U>
+    inline simd<T,N> radix_key_inverse (const simd<U,N> &u)
+    {
+        constexpr U h = U(std::is_signed<T>::value) << (8 * sizeof(U) - 1);
+
+        simd<U,N> m = std::is_floating_point<T>::value ? simd<U,N>((u >> (8 * sizeof(U) - 1)) - U(1)) : simd<U,N>(U(0));
+
+        return reinterpret<T>(u ^ (m | h));
+    }
+
+// Stable scatter of the keys of src by the byte at bit s, values follow the keys when P
+// is true. offsets are the positions of the buckets in dst and are advanced.
+template<bool P, class U>
+    inline void simd_radix_scatter (U *dst, const U *src, uint32_t *values_dst, const uint32_t *values_src, size_t n, unsigned int s, size_t *offsets)
+    {
+        // Elements in a cache line and in the buffer of a bucket, buffers of many cache
+        // lines make the misses of the TLB on the destination rare
+        constexpr unsigned int L = 64 / sizeof(U);
+        constexpr unsigned int W = 16 * L;
+
+        std::vector<U> keys(256 * W);
+        std::vector<uint32_t> values(P ? 256 * W : 0);
+        unsigned int fill[256] = {};
+
+        for (size_t i = 0; i < n; i++)
+        {
+            unsigned int b = (src[i] >> s) & 255;
+            unsigned int f = fill[b]++;
+
+            keys[b * W + f] = src[i];
+            if (P) values[b * W + f] = values_src[i];
+
+            if (f == W - 1)
+            {
+                for (unsigned int j = 0; j < W; j += L)
+                {
+                    simd<U,L>::loadu(&keys[b * W + j]).storeu(dst + offsets[b] + j);
+                    if (P) simd<uint32_t,L>::loadu(&values[b * W + j]).storeu(values_dst + offsets[b] + j);
+                }
+
+                offsets[b] += W;
+                fill[b] = 0;
+            }
+        }
+
+        for (unsigned int b = 0; b < 256; b++)
+            for (unsigned int f = 0; f < fill[b]; f++)
+            {
+                dst[offsets[b] + f] = keys[b * W + f];
+                if (P) values_dst[offsets[b] + f] = values[b * W + f];
+            }
+    }
+
+template<bool P, unsigned int N, class T>
+    inline void simd_radix_sort_bytes (T *first, T *last, uint32_t *permutation)
+    {
+        typedef std::make_unsigned_t<typename simd<T,N>::int_type::type> U;
+
+        constexpr unsigned int D = sizeof(U);
+
+        size_t n = last - first;
+
+        std::vector<U> a(n), b(n);
+        std::vector<uint32_t> pa(P ? n : 0), pb(P ? n : 0);
+
+        // Mapped keys and initial permutation
+        simd_transform_n<N>(a.data(), n, [](const simd<T,N> &s) { return radix_key(s); }, static_cast<const T *>(first));
+
+        for (size_t i = 0; P && i < n; i += N)
+            if (i + N <= n)
+                (lane_index<uint32_t,N>() + uint32_t(i)).storeu(&pa[i]);
+            else
+                (lane_index<uint32_t,N>() + uint32_t(i)).storeu(&pa[i], n - i);
+
+        // Histograms of all the bytes in a single pass of simd_histogram over the keys seen
+        // as bytes, the lane j of M bytes holds the byte j % D of a key (little endian) and
+        // it is counted in the histogram of that byte
+        constexpr unsigned int M = simd_native_size<uint8_t>;
+
+        size_t h[D][256];
+        const simd<uint16_t,M> digit = (lane_index<uint16_t,M>() % uint16_t(D)) * uint16_t(256);
+
+        simd_histogram<M>(&h[0][0], D * 256, reinterpret_cast<const uint8_t *>(a.data()), n * D,
+                          [digit](const simd<uint8_t,M> &x) { return simd<uint16_t,M>(x) + digit; });
+
+        U *src = a.data(), *dst = b.data();
+        uint32_t *psrc = pa.data(), *pdst = pb.data();
+
+        for (unsigned int d = 0; d < D; d++)
+        {
+            // Bytes equal in all keys are skipped
+            if (n == 0 || h[d][(src[0] >> (8 * d)) & 255] == n)
+                continue;
+
+            size_t offsets[256];
+
+            for (size_t k = 0, o = 0; k < 256; o += h[d][k], k++)
+                offsets[k] = o;
+
+            simd_radix_scatter<P>(dst, src, pdst, psrc, n, 8 * d, offsets);
+
+            std::swap(src, dst);
+            std::swap(psrc, pdst);
+        }
+
+        simd_transform_n<N>(first, n, [](const simd<U,N> &u) { return radix_key_inverse<T>(u); }, static_cast<const U *>(src));
+
+        if (P)
+            std::copy(psrc, psrc + n, permutation);
+    }
+
+// Radix sort of [first, last) in ascending order, for 32 and 64-bit integers and floating
+// point keys without NaN. The sort is stable, the second version writes in permutation[i]
+// the original position of the key that ends in position i (for less than 2^32 keys),
+// it can be used to move payloads of any type.
+template<unsigned int N, class T>
+    inline void simd_radix_sort (T *first, T *last)
+    {
+        static_assert(sizeof(T) == 4 || sizeof(T) == 8, "unsupported type");
+        simd_radix_sort_bytes<false,N>(first, last, nullptr);
+    }
+
+template<unsigned int N, class T>
+    inline void simd_radix_sort (T *first, T *last, uint32_t *permutation)
+    {
+        static_assert(sizeof(T) == 4 || sizeof(T) == 8, "unsupported type");
+        simd_radix_sort_bytes<true,N>(first, last, permutation);
+    }
+
+template<class T>
+    inline void simd_radix_sort (T *first, T *last) { simd_radix_sort<simd_native_size<T>>(first, last); }
+
+template<class T>
+    inline void simd_radix_sort (T *first, T *last, uint32_t *permutation) { simd_radix_sort<simd_native_size<T>>(first, last, permutation); }
+
+#endif
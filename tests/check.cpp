@@ -0,0 +1,570 @@
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include "../simd_sort.hpp"
+#include "../simd_scan.hpp"
+#include "../simd_hash.hpp"
+
+// Checks of the algorithms against the standard library, the exit status is the number
+// of failures.
+
+std::mt19937_64 rng(1);
+int failures = 0;
+
+void check (bool ok, const char *what, const char *type, const char *input, size_t n)
+{
+    if (!ok)
+    {
+        std::cout << "FAILED: " << what << " of " << n << " " << type << " (" << input << ")" << std::endl;
+        failures++;
+    }
+}
+
+// Random key, floating point keys are integers divided by 7 so that they have no NaN
+template<class T>
+    T random_key (unsigned int distinct)
+    {
+        uint64_t r = distinct ? rng() % distinct : rng();
+        T t;
+
+        if (std::is_floating_point<T>::value)
+            t = T(int64_t(r % 2000001) - 1000000) / 7;
+        else if (distinct)
+            t = T(r);
+        else
+            std::memcpy(&t, &r, sizeof(T));
+
+        return t;
+    }
+
+template<class T>
+    void check_sort (const char *type, const char *input, const std::vector<T> &v)
+    {
+        typedef std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t> I;
+        size_t n = v.size();
+
+        std::vector<T> r = v;
+        std::sort(r.begin(), r.end());
+
+        // Original positions in the order of a stable sort
+        std::vector<uint32_t> p(n);
+        for (size_t i = 0; i < n; i++)
+            p[i] = i;
+
+        std::stable_sort(p.begin(), p.end(), [&v](uint32_t a, uint32_t b) { return v[a] < v[b]; });
+
+        std::vector<T> w = v;
+        simd_sort(w.data(), w.data() + n);
+        check(w == r, "simd_sort", type, input, n);
+
+        // The values must be a permutation that moves every key to its place
+        std::vector<I> q(n);
+        for (size_t i = 0; i < n; i++)
+            q[i] = i;
+
+        w = v;
+        simd_sort(w.data(), w.data() + n, q.data());
+        bool moved = w == r;
+
+        for (size_t i = 0; i < n && moved; i++)
+            moved = q[i] < n && v[q[i]] == w[i];
+
+        std::sort(q.begin(), q.end());
+
+        for (size_t i = 0; i < n && moved; i++)
+            moved = q[i] == i;
+
+        check(moved, "simd_sort with values", type, input, n);
+
+        w = v;
+        simd_radix_sort(w.data(), w.data() + n);
+        check(w == r, "simd_radix_sort", type, input, n);
+
+        std::vector<uint32_t> s(n);
+        w = v;
+        simd_radix_sort(w.data(), w.data() + n, s.data());
+        check(w == r && s == p, "simd_radix_sort with permutation", type, input, n);
+    }
+
+template<class T>
+    void check_sort (const char *type)
+    {
+        for (size_t n : {0, 1, 2, 7, 8, 9, 31, 100, 255, 256, 257, 1000, 4099, 100000})
+        {
+            std::vector<T> v(n);
+
+            for (T &x : v)
+                x = random_key<T>(0);
+
+            check_sort(type, "random", v);
+
+            std::sort(v.begin(), v.end());
+            check_sort(type, "sorted", v);
+
+            std::reverse(v.begin(), v.end());
+            check_sort(type, "reversed", v);
+
+            for (T &x : v)
+                x = random_key<T>(16);
+
+            check_sort(type, "duplicates", v);
+        }
+    }
+
+// Upper half of the products against the scalar product of the widened values, for random
+// values and for the extremes of T
+template<class T, unsigned int N>
+    bool check_mulhi ()
+    {
+        typedef std::conditional_t<std::is_signed<T>::value, int64_t, uint64_t> W;
+
+        const T extremes[] = {std::numeric_limits<T>::min(), T(std::numeric_limits<T>::min() + 1), T(-1), T(0), T(1), std::numeric_limits<T>::max()};
+        bool ok = true;
+
+        for (unsigned int r = 0; r < 1000; r++)
+        {
+            simd<T,N> a, b;
+
+            for (unsigned int j = 0; j < N; j++)
+            {
+                a[j] = r < 36 ? extremes[(r + j) % 6] : T(rng());
+                b[j] = r < 36 ? extremes[r / 6] : T(rng());
+            }
+
+            simd<T,N> h = mulhi(a, b);
+
+            for (unsigned int j = 0; j < N; j++)
+                ok = ok && h[j] == T((W(a[j]) * W(b[j])) >> (8 * sizeof(T)));
+        }
+
+        return ok;
+    }
+
+template<unsigned int N>
+    void check_mulhi ()
+    {
+        bool ok = check_mulhi<int8_t,N>()  && check_mulhi<uint8_t,N>()  &&
+                  check_mulhi<int16_t,N>() && check_mulhi<uint16_t,N>() &&
+                  check_mulhi<int32_t,N>() && check_mulhi<uint32_t,N>();
+
+        check(ok, "mulhi against the widened product", "integers", "random values and extremes", N);
+    }
+
+// Generic half precision and bfloat16 conversions against the native ones (F16C, AVX-512F
+// and AVX512-BF16), selected by the size of the objects. All the 65536 halves are converted
+// to float and back, with floats between them and random ones. The results are compared
+// as bits, NaN included.
+template<unsigned int N>
+    void check_half ()
+    {
+        bool ok = true, bf = true;
+
+        for (uint32_t i = 0; i < 65536; i += N)
+        {
+            simd<uint16_t,N> h = lane_index<uint16_t,N>() + uint16_t(i);
+            simd<uint32_t,N> f = reinterpret<uint32_t>(half_to_float(h));
+
+            ok = ok && all(reinterpret<uint32_t>(half_to_float<N>(h)) == f);
+
+            for (uint32_t d : {0x0u, 0x800u, 0xFFFu, 0x1000u, 0x1001u, 0x2000u, 0x7FFFFu, uint32_t(rng())})
+            {
+                simd<float,N> x = reinterpret<float>(f + d);
+
+                ok = ok && all(float_to_half<N>(x) == float_to_half(x));
+                bf = bf && all(bfloat_from_float<N>(x) == bfloat_from_float(x));
+            }
+        }
+
+        check(ok, "generic half conversions against the native ones", "uint16_t", "all the halves", N);
+        check(bf, "generic bfloat16 conversion against the native one", "float", "all the halves", N);
+    }
+
+// Saturating conversion of floating point values to every integer type, NaN must become
+// zero and the values out of range the nearest limit. The expected results are given by
+// kind, not by comparisons that -Ofast may fold for NaN and infinities.
+template<class U, class T, unsigned int N>
+    bool check_convert_saturate ()
+    {
+        typedef std::numeric_limits<T> LT;
+        typedef std::numeric_limits<U> LU;
+
+        enum { zero, max, lowest, exact };
+
+        const std::pair<T,int> values[] =
+        {
+            {LT::quiet_NaN(), zero}, {-LT::quiet_NaN(), zero}, {LT::infinity(), max}, {-LT::infinity(), lowest},
+            {T(1e30), max}, {T(-1e30), std::is_signed<U>::value ? lowest : zero}, {T(LU::max()) * 2, max}, {T(LU::max() / 2 + 1) * 2, max},
+            {T(LU::max() / 4), exact}, {T(LU::lowest()), std::is_signed<U>::value ? exact : zero}, {T(-0.7), zero}, {T(0.7), zero},
+            {T(-1.5), std::is_signed<U>::value ? exact : zero}, {T(1.5), exact}, {T(42.9), exact}, {T(0), zero}
+        };
+
+        bool ok = true;
+
+        for (unsigned int i = 0; i < 16; i += N)
+        {
+            simd<T,N> s;
+
+            for (unsigned int j = 0; j < N; j++)
+                s[j] = values[i + j].first;
+
+            simd<U,N> r = convert_saturate<U>(s);
+
+            for (unsigned int j = 0; j < N; j++)
+            {
+                int k = values[i + j].second;
+                ok = ok && r[j] == (k == zero ? U(0) : k == max ? LU::max() : k == lowest ? LU::lowest() : U(values[i + j].first));
+            }
+        }
+
+        return ok;
+    }
+
+template<class T, unsigned int N>
+    void check_convert_saturate (const char *type)
+    {
+        bool ok = check_convert_saturate<int8_t,T,N>()  && check_convert_saturate<uint8_t,T,N>()  &&
+                  check_convert_saturate<int16_t,T,N>() && check_convert_saturate<uint16_t,T,N>() &&
+                  check_convert_saturate<int32_t,T,N>() && check_convert_saturate<uint32_t,T,N>() &&
+                  check_convert_saturate<int64_t,T,N>() && check_convert_saturate<uint64_t,T,N>();
+
+        check(ok, "convert_saturate to every integer type", type, "NaN, infinities and out of range", N);
+    }
+
+// Division by a simd_divider against the scalar / and %, for every numerator and divisor
+// of 8 bits and for the extremes of 32 bits. The results are compared as T, so that the
+// quotient of the smallest value by -1 wraps around as the scalar one converted back.
+template<class T>
+    bool check_divider (const std::vector<int64_t> &numerators, const std::vector<int64_t> &divisors)
+    {
+        constexpr unsigned int N = 16;
+        bool ok = true;
+
+        for (int64_t d : divisors)
+        {
+            simd_divider<T> v{T(d)};
+
+            for (size_t i = 0; i < numerators.size(); i += N)
+            {
+                simd<T,N> n = T(0);
+
+                for (unsigned int j = 0; j < N && i + j < numerators.size(); j++)
+                    n[j] = T(numerators[i + j]);
+
+                simd<T,N> q = n / v, r = n % v;
+
+                for (unsigned int j = 0; j < N && i + j < numerators.size(); j++)
+                    ok = ok && q[j] == T(int64_t(n[j]) / d) && r[j] == T(int64_t(n[j]) % d);
+            }
+        }
+
+        return ok;
+    }
+
+template<class T>
+    void check_divider (const char *type)
+    {
+        std::vector<int64_t> all;
+
+        for (int64_t x = std::numeric_limits<T>::min(); x <= std::numeric_limits<T>::max(); x++)
+            all.push_back(x);
+
+        std::vector<int64_t> divisors = all;
+        divisors.erase(std::find(divisors.begin(), divisors.end(), 0));
+
+        check(check_divider<T>(all, divisors), "simd_divider", type, "all numerators and divisors", all.size());
+    }
+
+void check_divider ()
+{
+    check_divider<int8_t>("int8_t");
+    check_divider<uint8_t>("uint8_t");
+
+    std::vector<int64_t> n32 = {INT32_MIN, INT32_MIN + 1, -1, 0, 1, INT32_MAX};
+    std::vector<int64_t> d32 = {INT32_MIN, INT32_MIN + 1, -7, -1, 1, 2, 3, 7, INT32_MAX};
+
+    check(check_divider<int32_t>(n32, d32), "simd_divider", "int32_t", "INT_MIN and INT_MAX", n32.size());
+}
+
+// Integer division and remainder over arrays whose last object is partial, the lanes after
+// the end must not be passed to the functions as zero divisors
+void check_transform ()
+{
+    auto add = [](const auto &a, const auto &b) { return a + b; };
+
+    for (size_t n = 0; n < 40; n++)
+    {
+        std::vector<int32_t> a(n), b(n), q(n);
+
+        for (size_t i = 0; i < n; i++)
+        {
+            a[i] = int32_t(rng() % 2001) - 1000;
+            b[i] = int32_t(rng() % 99) + 1;
+        }
+
+        simd_transform<8>(a.data(), a.data() + n, b.data(), q.data(), [](const auto &x, const auto &y) { return x / y; });
+
+        int32_t r = simd_transform_reduce<8>(a.data(), a.data() + n, b.data(), int32_t(0), add, [](const auto &x, const auto &y) { return x % y; });
+
+        bool ok = true;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            ok = ok && q[i] == a[i] / b[i];
+            r -= a[i] % b[i];
+        }
+
+        check(ok && r == 0, "simd_transform of x / y and x % y", "int32_t", "tail", n);
+    }
+}
+
+// Search and count with a predicate that divides by the elements, as above
+void check_find ()
+{
+    auto pred = [](const auto &x) { return 100 / x == 3; };
+
+    for (size_t n = 0; n < 40; n++)
+    {
+        std::vector<int32_t> a(n);
+
+        for (int32_t &x : a)
+            x = (int32_t(rng() % 61) - 30) | 1;
+
+        const int32_t *f = simd_find_if<8>(a.data(), a.data() + n, pred);
+        size_t c = simd_count_if<8>(a.data(), a.data() + n, pred);
+
+        bool ok = f == std::find_if(a.data(), a.data() + n, [](int32_t x) { return 100 / x == 3; }) &&
+                  c == size_t(std::count_if(a.begin(), a.end(), [](int32_t x) { return 100 / x == 3; }));
+
+        check(ok, "simd_find_if and simd_count_if of 100 / x", "int32_t", "tail", n);
+    }
+}
+
+// Histogram with a binner that divides by the elements, as above
+void check_histogram ()
+{
+    for (size_t n = 0; n < 300; n += 7)
+    {
+        std::vector<int32_t> a(n);
+        std::vector<uint32_t> h(21), r(21, 0);
+
+        for (int32_t &x : a)
+        {
+            x = (int32_t(rng() % 61) - 30) | 1;
+            r[100 / x / 10 + 10]++;
+        }
+
+        simd_histogram<8>(h.data(), 21, a.data(), n, [](const auto &x) { return 100 / x / 10 + 10; });
+
+        check(h == r, "simd_histogram of 100 / x", "int32_t", "tail", n);
+    }
+}
+
+// Scans with the same predicate, as a bitmap and as a selection vector
+void check_scan ()
+{
+    auto pred = [](const auto &x) { return 100 / x == 3; };
+
+    for (size_t n = 0; n < 200; n += 7)
+    {
+        std::vector<int32_t> a(n);
+        std::vector<uint64_t> bitmap((n + 63) / 64);
+        std::vector<uint32_t> selection(n), r;
+
+        for (int32_t &x : a)
+            x = (int32_t(rng() % 61) - 30) | 1;
+
+        for (size_t i = 0; i < n; i++)
+            if (100 / a[i] == 3)
+                r.push_back(i);
+
+        simd_scan_bitmap<8>(bitmap.data(), n, pred, a.data());
+        selection.resize(simd_scan_select<8>(selection.data(), n, pred, a.data()));
+
+        bool ok = selection == r && bitmap_count(bitmap.data(), bitmap.size()) == r.size();
+
+        for (uint32_t i : r)
+            ok = ok && (bitmap[i / 64] >> (i % 64) & 1);
+
+        check(ok, "simd_scan_bitmap and simd_scan_select of 100 / x", "int32_t", "tail", n);
+    }
+}
+
+// Gather and scatter of random indexes, the scatter has distinct ones
+template<class T, unsigned int N>
+    bool check_gather ()
+    {
+        std::vector<T> p(4 * N), q(4 * N, T(0));
+        simd<int32_t,N> index;
+
+        for (unsigned int i = 0; i < 4 * N; i++)
+            p[i] = T(rng() % 1000);
+
+        for (unsigned int j = 0; j < N; j++)
+            index[j] = 4 * j + rng() % 4;
+
+        simd<T,N> g = gather(p.data(), index);
+        scatter(q.data(), index, g);
+
+        bool ok = true;
+
+        for (unsigned int j = 0; j < N; j++)
+            ok = ok && g[j] == p[index[j]] && q[index[j]] == p[index[j]];
+
+        return ok;
+    }
+
+template<unsigned int N>
+    void check_gather ()
+    {
+        bool ok = check_gather<int32_t,N>() && check_gather<uint32_t,N>() && check_gather<float,N>() &&
+                  check_gather<int64_t,N>() && check_gather<uint64_t,N>() && check_gather<double,N>() &&
+                  check_gather<uint16_t,N>();
+
+        check(ok, "gather and scatter", "integers and floats", "random indexes", N);
+    }
+
+// Sum, count, minimum and maximum of groups against a scalar loop, the values are small
+// integers so that the sums of floating point values are exact in any order
+template<unsigned int N, class A, class K>
+    void check_group (const char *type, size_t groups)
+    {
+        for (size_t n : {0, 1, 5, 31, 64, 1000, 100003})
+        {
+            std::vector<K> keys(n);
+            std::vector<A> values(n);
+
+            for (size_t i = 0; i < n; i++)
+            {
+                keys[i] = K(rng() % (i % 3 ? groups : std::min<size_t>(groups, 3)));
+                values[i] = A(int(rng() % 2001) - 1000);
+            }
+
+            std::vector<A> sums(groups, A(0)), counts(groups, A(0)), mins(groups, std::numeric_limits<A>::max()), maxs(groups, std::numeric_limits<A>::lowest());
+
+            for (size_t i = 0; i < n; i++)
+            {
+                sums[keys[i]] += values[i];
+                counts[keys[i]] += 1;
+                mins[keys[i]] = std::min(mins[keys[i]], values[i]);
+                maxs[keys[i]] = std::max(maxs[keys[i]], values[i]);
+            }
+
+            std::vector<A> s(groups), c(groups), lo(groups), hi(groups);
+
+            simd_group_sum<N>(s.data(), groups, keys.data(), values.data(), n);
+            simd_group_count<N>(c.data(), groups, keys.data(), n);
+            simd_group_min<N>(lo.data(), groups, keys.data(), values.data(), n);
+            simd_group_max<N>(hi.data(), groups, keys.data(), values.data(), n);
+
+            // The groups without rows have infinities as minimum and maximum
+            for (size_t g = 0; g < groups; g++)
+                if (counts[g] == 0)
+                    lo[g] = mins[g], hi[g] = maxs[g];
+
+            check(s == sums && c == counts && lo == mins && hi == maxs, "simd_group_reduce", type, "random keys", n);
+        }
+    }
+
+// Random insertions and removals of keys in a small range, so that they are often found
+void check_hash (uint64_t range, size_t operations)
+{
+    simd_hash_map<uint64_t, uint64_t> m;
+    std::unordered_map<uint64_t, uint64_t> r;
+    bool ok = true;
+
+    for (size_t i = 0; i < operations && ok; i++)
+    {
+        uint64_t k = rng() % range;
+
+        switch (rng() % 4)
+        {
+            case 0:
+            case 1:
+                ok = m.insert(k, i).second == r.insert({k, i}).second;
+                break;
+
+            case 2:
+                ok = m.erase(k) == (r.erase(k) != 0);
+                break;
+
+            case 3:
+                const uint64_t *v = m.find(k);
+                auto j = r.find(k);
+                ok = j == r.end() ? v == nullptr : v != nullptr && *v == j->second;
+                break;
+        }
+
+        ok = ok && m.size() == r.size();
+    }
+
+    // All the keys of the range looked up at once
+    std::vector<uint64_t> q(range), out(range);
+    std::unique_ptr<bool[]> found(new bool[range]);
+
+    for (uint64_t k = 0; k < range; k++)
+        q[k] = k;
+
+    m.find_batch(q.data(), range, out.data(), found.get());
+
+    for (uint64_t k = 0; k < range && ok; k++)
+    {
+        auto j = r.find(k);
+        ok = found[k] == (j != r.end()) && (!found[k] || out[k] == j->second);
+    }
+
+    check(ok, "simd_hash_map", "uint64_t", "random operations", range);
+}
+
+int main()
+{
+    check_sort<float>("float");
+    check_sort<double>("double");
+    check_sort<int32_t>("int32_t");
+    check_sort<uint32_t>("uint32_t");
+    check_sort<int64_t>("int64_t");
+    check_sort<uint64_t>("uint64_t");
+
+    check_mulhi<4>();
+    check_mulhi<8>();
+    check_mulhi<16>();
+    check_mulhi<32>();
+
+    check_half<8>();
+    check_half<16>();
+
+    check_convert_saturate<float,4>("float");
+    check_convert_saturate<float,8>("float");
+    check_convert_saturate<float,16>("float");
+    check_convert_saturate<double,2>("double");
+    check_convert_saturate<double,4>("double");
+    check_convert_saturate<double,8>("double");
+
+    check_divider();
+    check_transform();
+    check_find();
+    check_histogram();
+
+    check_gather<4>();
+    check_gather<8>();
+    check_gather<16>();
+
+    check_group<16, int32_t,  uint8_t> ("int32_t",  256);
+    check_group<8,  int32_t,  uint8_t> ("int32_t",  3);
+    check_group<16, float,    uint8_t> ("float",    10);
+    check_group<8,  double,   uint16_t>("double",   1000);
+    check_group<8,  int64_t,  uint16_t>("int64_t",  65536);
+    check_group<4,  uint32_t, uint8_t> ("uint32_t", 17);
+    check_scan();
+
+    for (uint64_t range : {10, 1000, 100000})
+        check_hash(range, 1000000);
+
+    std::cout << (failures ? "Some checks failed." : "All checks passed.") << std::endl;
+    return failures;
+}
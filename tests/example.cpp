@@ -19,8 +19,8 @@ int main()
                                             // instructions depending depending 
                                             // on which optimizations have been enabled.
 
-    f32x8 b = (a > 9).blend(x, y); // Equivalent for each i to : a[i] = z[i] > 9 ? x[i] : y[i] 
-    f32x8 c = (x < y).blend(x, y); // Smaller values between x and y
+    f32x8 b = blend(a > 9, x, y); // Equivalent for each i to : a[i] = z[i] > 9 ? x[i] : y[i] 
+    f32x8 c = blend(x < y, x, y); // Smaller values between x and y
 
 
     // Assigment operators
@@ -45,6 +45,9 @@ int main()
     // Shuffle elements of x using indexes
     f32x8 x_shuffled = x[indexes];
 
+    // Same shuffle with indexes known at compile time
+    f32x8 x_permuted = permute<0,3,2,5,1,4,6,7>(x);
+
     // Prints all values of x_shuffled
     std::cout << "x_shuffled: " << x_shuffled << std::endl;
     return 0;